@@ -1,9 +1,10 @@
+#pragma once
 #include <iostream>
 #include <glm/glm.hpp>
+#include <TrailArena.hpp>
+#include <PhysicsConstants.hpp>
+#include <Integrators.hpp>
 #include <vector>
-//physics constants
-const double G = 1.0;           // Gravitational constant (pixel units)
-const double C = 100.0;         // Speed of light (pixels/second)
 
 struct BlackHole
 {
@@ -12,45 +13,21 @@ struct BlackHole
 	double schwarzschildRadius;
 
 	BlackHole(glm::vec2 pos, double m );
-};
-struct RayState
-{
-	float r;				//distance from black hole center 
-	float theta;			//angle from the black hole center.(radians)
-	float dr_dlambda;		//radial velocity. (moving toward/away)
-	float dtheta_dlambda;    //angular velocity. (rotating around)
-
-	//allowing for adding states together
-	//For adding states together (for RK4 math)
-	RayState operator+(const RayState& other) const
-	{
-		return RayState{
-			r + other.r,
-			theta + other.theta,
-			dr_dlambda + other.dr_dlambda,
-			dtheta_dlambda + other.dtheta_dlambda
-		};
-	}
-
-	// Allow multiplying state by a scalar (for RK4 math)
-	RayState operator*(float scalar) const
-	{
-		return RayState{
-			r * scalar,
-			theta * scalar,
-			dr_dlambda * scalar,
-			dtheta_dlambda* scalar
-		};
-	}
 
+	// Used to notice when the hole moved or changed mass (anything traced with the old one is stale)
+	bool operator==(const BlackHole& other) const = default;
 };
+// The app integrates in float (like geodesic.comp), the templates in Integrators.hpp also take double
+using RayState = BasicRayState<float>;
+
 //this would hold the state of a single light ray.
 struct LightRay
 {
 	glm::vec2 position;
 	glm::vec2 velocity;
 
-	std::vector<glm::vec2> trail;
+	// Where step() records positions (a slot in a shared TrailArena). Left empty = no trail is kept.
+	TrailHandle trail;
 
 	//physics fields
 	float r;				//distance from black hole center 
@@ -58,13 +35,19 @@ struct LightRay
 	float dr_dlambda;		//radial velocity. (moving toward/away)
 	float dtheta_dlambda;    //angular velocity. (rotating around)
 
-	// Accelerations (from geodesic equations)
+	// Accelerations (from geodesic equations, filled in by calculateAccelerations)
 	float d2r_dlambda2;         // Radial acceleration
 	float d2theta_dlambda2;     // Angular acceleration
 	// Control
 	bool active;                // Becomes false at event horizon
 
+	// Step size the adaptive integrator will try next (0 = not picked yet)
+	float adaptiveStepSize = 0.0f;
+
 	void step(float deltaTime, const BlackHole& blackHole);
+	// Advance by exactly deltaTime using as many adaptive Dormand-Prince sub-steps as the tolerance needs
+	void stepAdaptive(float deltaTime, const BlackHole& blackHole, const AdaptiveStepSettings& settings,
+		IntegratorStats* stats = nullptr);
 	void initialize(glm::vec2 startPos, glm::vec2 startVel, const BlackHole& blackHole);
 };
 
@@ -78,3 +61,17 @@ void calculateAccelerations(LightRay& ray, const BlackHole& bh);
 // RK4 helper functions
 RayState getRayState(const LightRay& ray);
 void setRayState(LightRay& ray, const RayState& state);
+
+// Stateless versions of the geodesic math (same as calculateDerivatives/rk4Step in geodesic.comp),
+// float instances of geodesicDerivatives / RK4 / dormandPrinceStep from Integrators.hpp
+// Returns (dr/dlambda, dtheta/dlambda, d2r/dlambda2, d2theta/dlambda2) for the given state
+RayState calculateDerivatives(const RayState& state, float Rs);
+RayState rk4Step(const RayState& initial, float deltaTime, float Rs);
+
+// Dormand-Prince 5(4) step with error control (same as dopri5Step in geodesic.comp).
+// Takes one accepted step starting with stepSize, shrinking and retrying until the error fits.
+// On return state is advanced, the return value is the step actually taken and
+// stepSize holds the suggested size for the next step. stepCap > 0 limits the step taken,
+// even below settings.minStep.
+float dopri5Step(RayState& state, float& stepSize, float Rs, const AdaptiveStepSettings& settings,
+	IntegratorStats* stats = nullptr, float stepCap = 0.0f);
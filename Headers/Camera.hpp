@@ -33,4 +33,23 @@ public:
     void processMouseDrag(float deltaX, float deltaY);
     void processMouseScroll(float delta);
     void processKeyboard(GLFWwindow* window, float deltaTime);
+
+    // Change tracking: true if target, radius, azimuth, elevation or fov changed since the last call
+    // (compares against a snapshot, so it also catches code writing the fields directly)
+    bool consumeChanges();
+
+private:
+    struct ViewState
+    {
+        glm::vec3 target;
+        float radius;
+        float azimuth;
+        float elevation;
+        float fov;
+
+        bool operator==(const ViewState& other) const = default;
+    };
+
+    ViewState lastView{};
+    bool hasLastView = false;  // the first call always reports a change
 };
\ No newline at end of file
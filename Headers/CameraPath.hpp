@@ -0,0 +1,49 @@
+#pragma once
+#include <Camera.hpp>
+#include <string>
+#include <vector>
+
+//a keyframed fly-around for the offline animation renderer (--animate).
+//each keyframe pins the orbit camera (radius, azimuth, elevation, fov) at a time,
+//in between the values follow a Catmull-Rom spline so the motion has no corners.
+//
+//path files are plain text, one keyframe per line, '#' starts a comment:
+//  # time(s)  radius  azimuth(deg)  elevation(deg)  fov(deg)
+//  0          650     45            75              45
+//  4          900     225           20              50
+
+struct CameraKeyframe
+{
+	float time;       // seconds
+	float radius;
+	float azimuth;    // radians (like Camera)
+	float elevation;  // radians
+	float fov;        // degrees
+};
+
+class CameraPath
+{
+public:
+	CameraPath() = default;
+
+	// Keyframes have to be added in time order
+	void addKeyframe(const CameraKeyframe& keyframe);
+
+	// Returns false (and prints why) if the file can't be read or has a bad line
+	bool loadFromFile(const std::string& filePath);
+
+	// One full turn around the target in `duration` seconds, starting from where camera is now
+	static CameraPath orbit(const Camera& camera, float duration);
+
+	bool empty() const;
+	float getDuration() const;
+	const std::vector<CameraKeyframe>& getKeyframes() const;
+
+	// Camera values at `time` (clamped to the first/last keyframe)
+	CameraKeyframe sample(float time) const;
+	// Put the values at `time` into camera (target and limits are left alone)
+	void apply(Camera& camera, float time) const;
+
+private:
+	std::vector<CameraKeyframe> keyframes;
+};
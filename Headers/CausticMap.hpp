@@ -0,0 +1,74 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <BlackHole.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+//a photon density map of the 2D scene: where lensed light piles up (the caustics around the photon sphere).
+//a dense beam of parallel rays comes in from the left edge, every ray is stepped with RK4 and adds one
+//count to the grid cell it is in after every step. on the CPU the rays run in RayBatch chunks over a
+//ThreadPool, each thread counts into its own private grid and the grids are summed at the end, so the
+//threads never write to the same memory. CausticRenderer builds the same map on the GPU with atomic adds.
+
+// The ray field and the grid (the same numbers go to caustics.comp)
+struct CausticSettings
+{
+	int gridWidth = 800;                          // cells across the scene
+	int gridHeight = 600;
+	glm::vec2 sceneSize = glm::vec2(800.0f, 600.0f);  // scene units the grid covers, from (0, 0)
+	float emitterX = 0.0f;                        // the rays start on this vertical line, moving +x
+	float speed = 100.0f;                         // C, one step moves a ray about speed * deltaTime
+	float deltaTime = 0.02f;                      // about 2 scene units per step, close to one cell
+	int maxSteps = 600;                           // enough to cross the scene and wind around the hole a few times
+	float escapeRadius = 520.0f;                  // a ray this far out and moving away never comes back into the scene
+	uint32_t seed = 1234u;                        // jitter of the start points
+};
+
+// Start of ray `index` of `rayCount`: one ray per equal slice of the emitter line, at a random (seeded)
+// spot inside its slice, and up to one step behind the line. Without that every ray would be on the
+// same step at the same x and the counts would come out in stripes. caustics.comp does the same.
+glm::vec2 causticRayStart(uint32_t index, uint32_t rayCount, const CausticSettings& settings);
+
+// Hits a cell gets when nothing bends the beam (rays per cell row times steps per cell width)
+float causticReferenceCount(size_t rayCount, const CausticSettings& settings);
+// Log scaled density for display: log2(count / reference) from -2 (0) to +2 (1), so the undisturbed beam
+// sits in the middle, the shadows go dark and the caustics (4x and more) white. 0 for an empty cell.
+float causticDensity(uint32_t count, float reference);
+// Colour of a density (0..1), black through red and yellow to white (same ramp as caustics.frag)
+glm::vec3 causticColor(float density);
+
+class CausticMap
+{
+public:
+	explicit CausticMap(const CausticSettings& settings = CausticSettings());
+
+	// Integrate rayCount rays and bin them (replaces what was there). Blocks until done.
+	void build(size_t rayCount, const BlackHole& blackHole, ThreadPool& pool);
+
+	const CausticSettings& getSettings() const;
+	// Counts per cell, row by row, bottom row first (like the window)
+	const std::vector<uint32_t>& getCounts() const;
+	uint32_t getMaxCount() const;
+
+	size_t getRayCount() const;
+	unsigned long long getStepCount() const;   // RK4 steps taken by all rays together
+	double getBuildSeconds() const;
+
+	// causticDensity through causticColor, RGBA8, bottom row first (like CpuRenderer::getPixels)
+	std::vector<unsigned char> toRGBA() const;
+	bool writePPM(const std::string& filePath) const;
+
+	// Rays per chunk a thread takes at a time (a multiple of RayBatch::laneWidth)
+	static constexpr size_t chunkRays = 4096;
+
+private:
+	CausticSettings settings;
+	std::vector<uint32_t> counts;
+	uint32_t maxCount = 0;
+	size_t rayCount = 0;
+	unsigned long long stepCount = 0;
+	double buildSeconds = 0.0;
+};
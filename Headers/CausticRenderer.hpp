@@ -0,0 +1,69 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <CausticMap.hpp>
+#include <Shader.hpp>
+#include <cstdint>
+#include <vector>
+
+//builds a CausticMap's density grid on the GPU and draws it over the window.
+//caustics.comp runs one ray per invocation and counts into a shader storage buffer with atomicAdd,
+//a few batches of rays per frame so the window stays responsive while the map fills in.
+//caustics.frag reads the same buffer and shows it log scaled, nothing is read back
+//(except by checkAgainstCpu, which builds the same map with CausticMap and compares).
+
+// Result of CausticRenderer::checkAgainstCpu
+struct CausticCheck
+{
+	uint64_t cpuTotal = 0;           // counts over the whole grid
+	uint64_t gpuTotal = 0;
+	size_t cellsChecked = 0;         // cells with at least minCount CPU counts
+	size_t cellsAgreeing = 0;        // relative difference below the tolerance
+	float maxRelativeError = 0.0f;   // largest relative difference of any checked cell
+};
+
+class CausticRenderer
+{
+public:
+	// Rays one accumulate() call dispatches by default
+	static constexpr size_t defaultBatchRays = 1 << 18;
+
+	CausticRenderer(size_t rayCount, const CausticSettings& settings);
+	~CausticRenderer();
+
+	CausticRenderer(const CausticRenderer&) = delete;
+	CausticRenderer& operator=(const CausticRenderer&) = delete;
+
+	// Empty the grid and start over with the first ray
+	void reset();
+
+	// Dispatch the next batchRays rays with caustics.comp (needs the FrameParams block bound)
+	void accumulate(Shader& computeShader, size_t batchRays = defaultBatchRays);
+
+	// Draw the grid with caustics.vert/caustics.frag, blended by density. projection maps the scene
+	// to the viewport (the same one the trails use), the grid covers the scene.
+	void draw(Shader& drawShader, const glm::mat4& projection, glm::vec2 viewportSize, float opacity);
+
+	// Build the whole map on the GPU and with CausticMap::build over pool, then compare them cell by cell
+	// (needs the FrameParams block for blackHole bound). Leaves the grid empty.
+	CausticCheck checkAgainstCpu(Shader& computeShader, const BlackHole& blackHole, ThreadPool& pool,
+		uint32_t minCount = 32, float tolerance = 0.1f);
+
+	// The counts as they are now (waits for the GPU)
+	std::vector<uint32_t> readCounts() const;
+
+	bool isComplete() const;
+	size_t getRaysDone() const;
+	size_t getRayCount() const;
+	size_t memoryBytes() const;
+
+private:
+	size_t rayCount;
+	CausticSettings settings;
+	size_t raysDone = 0;
+
+	GLuint binBuffer = 0;   // one uint per cell
+	GLuint emptyVAO = 0;    // core profile needs a VAO bound to draw
+
+	void setGridUniforms(Shader& shader) const;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <string>
+
+//options picked on the command line.
+//with no arguments the program opens the normal GLFW window.
+struct AppOptions
+{
+	// --cpu : render headless on the CPU instead of opening a window
+	bool cpuRender = false;
+
+	int width = 800;             // --width
+	int height = 600;            // --height
+	unsigned threads = 0;        // --threads (0 = all cores), for --cpu, --caustics and the --trails simulation
+	int frames = 1;              // --frames (repeat the render to average the timing)
+	std::string outputPath = "frame.ppm";  // --output
+
+	// --adaptive : use the Dormand-Prince 5(4) integrator instead of fixed step RK4
+	bool adaptive = false;
+	float tolerance = 1.0e-4f;   // --tolerance
+
+	// --lookup : render from the precomputed deflection table instead of integrating every pixel
+	bool lookup = false;
+
+	// --hierarchical : trace every 8th pixel first and only refine tiles that aren't all sky, shadow or disk
+	bool hierarchical = false;
+
+	// --lens-cache MB : memory for lens maps, so orbiting the camera reuses what was traced for the same
+	// distance and elevation instead of integrating again (0 = off, the window only)
+	int lensCacheMB = 64;
+
+	// --trails N : shoot a fan of N 2D light rays in the window and draw their trails (0 = off)
+	int trailRays = 0;
+	// the trails are simulated on their own thread, these two don't depend on each other
+	float simRate = 60.0f;       // --sim-rate: simulation steps per second
+	float renderRate = 0.0f;     // --render-rate: cap on the window's frames per second (0 = no cap, vsync)
+
+	// --photons N : stream N photons around the hole entirely on the GPU (compute shader + SSBO trails, 0 = off)
+	int photons = 0;
+	int photonTrail = 16;        // --photon-trail: trail points per photon
+	// --photon-check : step the photons on the GPU and the CPU, compare them and exit (works under llvmpipe)
+	bool photonCheck = false;
+
+	// --caustics N : bin N rays of a parallel beam into a photon density map of the scene, log scaled
+	// (with --cpu: built over --threads and written to --output, in the window: built on the GPU and drawn over it)
+	int causticRays = 0;
+	// --caustic-check : build the caustic map on the GPU and the CPU, compare them and exit (works under llvmpipe)
+	bool causticCheck = false;
+
+	// --profile FILE : time every frame and pass, write the timings to FILE (.json or CSV) on exit
+	std::string profilePath;
+
+	// --animate : render a camera fly-around headless on the CPU and write every frame (implies --cpu)
+	bool animate = false;
+	std::string cameraPathFile;  // --path (keyframe file, default one turn around the hole)
+	int fps = 30;                // --fps
+	float duration = 0.0f;       // --duration seconds (0 = length of the path, 8 s for the default turn)
+
+	// --record FILE : write every frame the window shows to FILE (.y4m, - or a PPM pattern like --animate),
+	// read back asynchronously so the window doesn't slow down
+	std::string recordPath;
+
+	// --shader-dir DIR : read the shaders from DIR instead of the copies built into the executable
+	std::string shaderDirectory;
+	// --shader-cache DIR : where linked program binaries are kept between runs (--no-shader-cache = off)
+	std::string programCacheDirectory = "shader_cache";
+
+	bool showHelp = false;       // --help
+};
+
+// Returns false (and prints why) if the arguments could not be parsed
+bool parseCommandLine(int argc, char** argv, AppOptions& options);
+
+void printUsage(const char* programName);
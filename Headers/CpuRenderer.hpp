@@ -0,0 +1,108 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <BlackHole.hpp>
+#include <ThreadPool.hpp>
+#include <string>
+#include <vector>
+
+class DeflectionTable;
+
+//this is a CPU copy of Shaders/geodesic.comp.
+//it runs the exact same steps per pixel (ray generation, horizon test, disk test, RK4 march)
+//so frames can be rendered on machines without a GPU and without opening a window.
+
+// Same values as the uniforms the compute shader gets from main.cpp
+struct TraceParams
+{
+	glm::vec2 blackHolePos;  // u_blackHolePos
+	float mass;              // u_mass
+	float Rs;                // u_Rs
+	glm::vec2 screenSize;    // u_screenSize
+	glm::vec3 cameraPos;     // u_cameraPos
+	float cameraFOV;         // u_cameraFOV (degrees)
+	int integrator = 0;      // u_integrator (0 = fixed step RK4, 1 = adaptive Dormand-Prince 5(4))
+	float tolerance = 1.0e-4f;  // u_tolerance
+	int renderMode = 0;      // u_renderMode (0 = integrate every pixel, 1 = deflection table lookup)
+	const DeflectionTable* deflectionTable = nullptr;  // needed for renderMode 1
+	bool hierarchical = false;  // coarse-to-fine like Graphics::traceHierarchical (ignored for renderMode 1)
+};
+
+// What a ray ended up hitting (KIND_* in geodesic.comp)
+enum class PixelKind
+{
+	Escaped,
+	Captured,
+	Disk,        // disk hit straight away
+	LensedDisk   // disk hit after bending (shaded differently)
+};
+
+// Tile size of the coarse-to-fine mode (coarseTileSize in geodesic.comp)
+const int coarseTileSize = 8;
+
+// Timing of the last render() call
+struct RenderStats
+{
+	unsigned long long rays = 0;      // primary rays traced (one per pixel, fewer in hierarchical mode)
+	unsigned long long pixels = 0;    // pixels in the frame
+	unsigned long long tiles = 0;     // hierarchical mode: tiles in the frame
+	unsigned long long refinedTiles = 0;  // hierarchical mode: mixed tiles traced at full resolution
+	unsigned long long steps = 0;     // integration steps taken over all rays
+	unsigned long long rejectedSteps = 0;  // adaptive steps that had to be retried
+	double seconds = 0.0;
+	double raysPerSecond = 0.0;
+};
+
+//kernel helpers (same names as in geodesic.comp)
+glm::vec3 generateRayDirection(glm::vec2 pixelCoord, const TraceParams& params);
+bool intersectDisk(glm::vec3 rayOrigin, glm::vec3 rayDir, const TraceParams& params, float& hitDistance);
+float calculateDiskShading(glm::vec3 rayDir);
+glm::vec3 getDiskColor(float r, const TraceParams& params);
+
+// Runs tracePixel() of geodesic.comp for one pixel and returns the color it would store.
+// stats (optional) gets the ray's accepted/rejected steps added to it, kind (optional) what it hit.
+glm::vec4 traceGeodesicPixel(glm::ivec2 pixelCoord, const TraceParams& params, IntegratorStats* stats = nullptr,
+	PixelKind* kind = nullptr);
+
+// Lookup version (u_renderMode = 1): no integration, the path comes from params.deflectionTable
+glm::vec4 traceLookupPixel(glm::ivec2 pixelCoord, const TraceParams& params);
+
+class CpuRenderer
+{
+public:
+	//threadCount = 0 uses every core
+	CpuRenderer(int width, int height, unsigned threadCount = 0, int tileSize = 32);
+
+	int getWidth() const;
+	int getHeight() const;
+	unsigned getThreadCount() const;
+
+	// Trace the whole frame (blocks until done)
+	void render(const TraceParams& params);
+
+	// RGBA8 pixels, bottom row first (same layout as the GL texture)
+	const std::vector<unsigned char>& getPixels() const;
+
+	const RenderStats& getLastStats() const;
+
+	// Write the frame as a binary PPM (top row first, like it looks on screen)
+	bool writePPM(const std::string& filePath) const;
+
+private:
+	int width;
+	int height;
+	int tileSize;
+	ThreadPool pool;
+	std::vector<unsigned char> pixels;
+	RenderStats lastStats;
+
+	// coarse-to-fine buffers, kept between frames
+	std::vector<glm::vec4> coarseColors;
+	std::vector<PixelKind> coarseKinds;
+	std::vector<int> refineWorkList;
+
+	void renderTile(int tileIndex, int tilesX, const TraceParams& params, IntegratorStats& stats);
+	void storePixel(int x, int y, glm::vec4 color);
+
+	// the three passes of the coarse-to-fine mode, returns the number of rays traced
+	unsigned long long renderHierarchical(const TraceParams& params, std::vector<IntegratorStats*>& threadStats);
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <BlackHole.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ThreadPool;
+
+//precomputed light paths around one black hole.
+//a ray leaving an observer at distance r0 is fully described by its impact parameter
+//b = r0 * sin(angle between the ray and the direction to the hole), so instead of integrating
+//every pixel we integrate every (b, r0) pair once and look the answer up afterwards.
+//
+//b is stored normalised by r0 (s = b / r0 = sin(angle), 0..1) so one row covers every inward ray.
+//observer radii are spaced logarithmically between minRadius and maxRadius.
+//
+//for every (s, r0) the table keeps:
+//  - a summary: total angle swept, captured or escaped, deflection angle, closest approach
+//  - the path itself: Rs / r sampled at evenly spaced swept angles phi in [0, maxSweep].
+//    the disk plane cuts the orbital plane along a line through the hole, so the disk crossings
+//    sit at phi_d, phi_d + pi, phi_d + 2pi ... and their radii are just lookups into this path.
+
+struct DeflectionTableSettings
+{
+	int impactSamples = 256;     // s = b / r0 samples
+	int radiusSamples = 48;      // observer radius samples
+	int angleSamples = 96;       // swept angle samples along each path
+	float minRadius = 50.0f;     // observer radius range (matches Camera min/max radius)
+	float maxRadius = 2000.0f;
+	int diskCrossings = 3;       // how many disk plane crossings a path has to cover
+	float tolerance = 1.0e-6f;   // adaptive integrator tolerance used while building
+};
+
+// Summary of one precomputed path
+struct DeflectionEntry
+{
+	float sweptAngle;     // angle swept around the hole until the ray escaped or fell in
+	float captured;       // 1 = fell into the hole, 0 = escaped (blends between neighbours)
+	float deflection;     // change of travel direction (radians), 0 for captured rays
+	float closestRadius;  // smallest r reached
+};
+
+class DeflectionTable
+{
+public:
+	// Build the table for this black hole (the only input that matters is its mass / Rs).
+	// pool is optional, without it the table is built on the calling thread.
+	DeflectionTable(const BlackHole& blackHole, const DeflectionTableSettings& settings = DeflectionTableSettings(),
+		ThreadPool* pool = nullptr);
+
+	// True if the table was built for a black hole with this mass
+	bool matches(const BlackHole& blackHole) const;
+
+	const DeflectionTableSettings& getSettings() const;
+	float getRs() const;
+	float getMaxSweep() const;
+	double getBuildSeconds() const;
+
+	// Interpolated lookups (same filtering the GPU does on the textures)
+	DeflectionEntry sampleEntry(float s, float observerRadius) const;
+	// r at swept angle phi along the path. Only meaningful up to sampleEntry().sweptAngle,
+	// past the end of the path it reads Rs for captured rays and "infinity" for escaped ones.
+	float sampleRadius(float s, float observerRadius, float phi) const;
+
+	// Texture coordinates for the radius axis (log spaced)
+	float radiusCoordinate(float observerRadius) const;
+
+	// Raw data for uploading as textures
+	// entries: impactSamples x radiusSamples RGBA (DeflectionEntry)
+	// paths:   angleSamples x impactSamples x radiusSamples (Rs / r)
+	const std::vector<DeflectionEntry>& getEntries() const;
+	const std::vector<float>& getPaths() const;
+
+private:
+	DeflectionTableSettings settings;
+	float Rs;
+	float maxSweep;
+	double buildSeconds = 0.0;
+
+	std::vector<DeflectionEntry> entries;
+	std::vector<float> paths;
+
+	float observerRadiusAt(int index) const;
+	void buildEntry(int impactIndex, int radiusIndex);
+};
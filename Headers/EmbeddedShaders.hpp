@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+//the files of the Shaders folder, compiled into the executable at build time
+//(the table is generated by cmake/EmbedShaders.cmake). Shader::LoadShader reads from here
+//unless a shader directory was given on the command line.
+
+struct EmbeddedShader
+{
+	const char* name;    // file name, e.g. "geodesic.comp"
+	const char* source;  // null terminated
+	size_t size;         // without the terminator
+};
+
+extern const EmbeddedShader embeddedShaders[];
+extern const size_t embeddedShaderCount;
@@ -0,0 +1,68 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+//everything the shaders need to know about the current frame, in one uniform buffer.
+//instead of setting a dozen uniforms by name on every program each frame, the struct is
+//written into the buffer once and every program reads it from the same binding point.
+//the GLSL side lives in Shaders/FrameParams.glsl and uses std140, so the layout here
+//has to match it byte for byte (checked by the static_asserts below).
+
+// Uniform buffer binding point used by the FrameParams block in every program
+const GLuint frameParamsBinding = 0;
+
+struct FrameParams
+{
+	glm::mat4 cameraView;        // offset 0
+	glm::mat4 cameraProjection;  // offset 64
+	glm::vec3 cameraPos;         // offset 128 (vec3 is 16 aligned in std140, the float below fills the gap)
+	float cameraFOV;             // offset 140
+
+	glm::vec2 blackHolePos;      // offset 144
+	glm::vec2 screenSize;        // offset 152
+	float mass;                  // offset 160
+	float Rs;                    // offset 164
+
+	float tolerance;             // offset 168
+	int32_t integrator;          // offset 172
+	int32_t renderMode;          // offset 176
+
+	int32_t sampleIndex;         // offset 180
+	glm::vec2 jitter;            // offset 184
+};
+
+static_assert(sizeof(glm::vec3) == 12, "FrameParams expects tightly packed glm vectors");
+static_assert(offsetof(FrameParams, cameraProjection) == 64, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, cameraPos) == 128, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, cameraFOV) == 140, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, blackHolePos) == 144, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, screenSize) == 152, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, mass) == 160, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, Rs) == 164, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, tolerance) == 168, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, integrator) == 172, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, renderMode) == 176, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, sampleIndex) == 180, "FrameParams layout does not match std140");
+static_assert(offsetof(FrameParams, jitter) == 184, "FrameParams layout does not match std140");
+static_assert(sizeof(FrameParams) == 192, "FrameParams size does not match std140");
+
+// The uniform buffer holding FrameParams, bound to frameParamsBinding for its whole lifetime
+class FrameParamsBuffer
+{
+public:
+	FrameParamsBuffer();
+	~FrameParamsBuffer();
+
+	FrameParamsBuffer(const FrameParamsBuffer&) = delete;
+	FrameParamsBuffer& operator=(const FrameParamsBuffer&) = delete;
+
+	// Upload this frame's parameters (one glBufferSubData)
+	void update(const FrameParams& params);
+
+	GLuint getBuffer() const { return UBO; }
+
+private:
+	GLuint UBO = 0;
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//writes finished frames on a background thread, so the next frame can be traced while
+//the last one is being converted and written out. frames are copied into a small ring of
+//buffers, submit() only waits if the writer has fallen behind by the whole ring.
+
+enum class FrameFormat
+{
+	PPMSequence,  // one binary PPM per frame, the path has a %d (or %04d ...) for the frame number
+	Y4M           // one raw YUV4MPEG2 stream (4:4:4), "-" writes it to stdout (pipe it into ffmpeg)
+};
+
+class FrameWriter
+{
+public:
+	// queueDepth = frames that can wait to be written before submit() blocks
+	FrameWriter(FrameFormat format, const std::string& path, int width, int height, int fps, int queueDepth = 2);
+	~FrameWriter();
+
+	FrameWriter(const FrameWriter&) = delete;
+	FrameWriter& operator=(const FrameWriter&) = delete;
+
+	// .y4m and "-" are Y4M, anything else a PPM sequence
+	static FrameFormat formatForPath(const std::string& path);
+
+	// False if the output couldn't be opened (the reason was printed)
+	bool isOpen() const;
+
+	// Queue a frame: RGBA8, bottom row first (CpuRenderer::getPixels). Blocks while the queue is full.
+	// Returns false once a write has failed.
+	bool submit(const std::vector<unsigned char>& rgba);
+	// Same from a raw pointer (e.g. a mapped readback buffer), width * height * 4 bytes
+	bool submit(const unsigned char* rgba);
+
+	// Wait until every queued frame is written and stop the thread. False if any write failed.
+	bool finish();
+
+	int getFramesWritten() const;
+	double getWaitSeconds() const;   // time submit() spent waiting for a free buffer
+	double getWriteSeconds() const;  // time the writer thread spent converting and writing
+
+private:
+	FrameFormat format;
+	int width;
+	int height;
+	int fps;
+
+	std::string pathPrefix;      // PPM: the path around the frame number
+	std::string pathSuffix;
+	int numberWidth = 0;         // PPM: zero padded width of the frame number (%04d = 4)
+	std::FILE* stream = nullptr; // Y4M
+	bool ownsStream = false;     // false for stdout
+	bool opened = false;
+
+	std::vector<std::vector<unsigned char>> buffers;
+	std::deque<int> freeBuffers;
+	std::deque<int> readyBuffers;    // in frame order
+	std::vector<unsigned char> encoded;  // writer thread only
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable readyCondition;  // the writer waits here for frames
+	std::condition_variable freeCondition;   // submit() waits here for a buffer
+	bool stopping = false;
+	bool failed = false;
+	int framesWritten = 0;
+	double waitSeconds = 0.0;
+	double writeSeconds = 0.0;
+
+	void writerLoop();
+	bool writeFrame(int frameIndex, const std::vector<unsigned char>& rgba);
+	bool writePPM(int frameIndex, const std::vector<unsigned char>& rgba);
+	bool writeY4M(const std::vector<unsigned char>& rgba);
+};
@@ -3,14 +3,29 @@
 #include <GLFW/glfw3.h>
 #include <Mesh.hpp>
 #include <Shader.hpp>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <vector>
+
+class DeflectionTable;
+
+// Gets the pixels of one readback: RGBA8, bottom row first, width * height * 4 bytes.
+// The pointer is into mapped GPU memory and is only valid during the call (copy what you keep).
+using ReadbackConsumer = std::function<void(const unsigned char* rgba, int width, int height, uint64_t frame)>;
+
 //this folder holds the functions to render the quad onto the screen.
 //it will render a quad the size of the screen.
+//
+//the compute shader writes into a small ring of output textures. each finished frame gets a fence,
+//and the quad keeps showing the previous frame until that fence has passed, so tracing frame N+1
+//doesn't have to wait for frame N to be drawn and the other way round. a target the quad sampled
+//also gets a fence, and the compute pass waits for it on the GPU before writing into that target again.
 class Graphics
 {
 public:
-	//constructor
-	Graphics(int width, int height);
+	//constructor (targetCount = output textures in the ring, at least 2 for any overlap)
+	Graphics(int width, int height, int targetCount = 2);
 
 	// Destructor: cleanup resources
 	~Graphics();
@@ -18,26 +33,119 @@ public:
 	int getWidth() const;
 	int getHeight() const;
 
-	// Resize the compute texture (for dynamic resolution)
-	void resize(int newWidth, int newHeight);
+	// Resize the compute textures (for dynamic resolution). The old ones are deleted once the GPU
+	// is done with them, so this doesn't wait for the frames still in flight.
+	// Returns true if the textures were replaced: the accumulated samples are gone (the new
+	// accumulation texture starts out cleared), so the caller has to restart at sample 0.
+	bool resize(int newWidth, int newHeight);
 
+	// The target the last finished compute pass wrote (what readbacks copy)
 	GLuint getTexture() const;
+	GLuint getAccumulationTexture() const;
+	int getTargetCount() const;
 
-	// Bind texture as image for compute shader (call before dispatch)
+	// Bind the output target being written (image unit 0) and the accumulation texture (image unit 1)
+	// for the compute shader (call before dispatch)
 	void bindForCompute();
 
-	// Render the fullscreen quad with the texture
+	// Call after the frame's dispatches: makes the writes visible, fences the target and moves on to
+	// the next one. renderQuad presents the target once its fence has passed.
+	void endCompute();
+
+	// Render the fullscreen quad with the newest finished target
 	void renderQuad(Shader& quadShader);
 
 	// Get work group counts for compute dispatch
 	void getWorkGroups(int& outX, int& outY) const;
 
+	// Trace the frame coarse-to-fine (geodesic.comp u_pass 1..3): rays on every 8th pixel,
+	// tiles whose corners agree get filled in, the rest are traced at full resolution
+	// through an indirect dispatch built on the GPU. Call after bindForCompute().
+	void traceHierarchical(Shader& computeShader);
+
+	// Mixed tiles the last traceHierarchical() refined (reads back from the GPU, so it waits)
+	GLuint readRefinedTileCount() const;
+	int getTileCount() const;
+
+	// Upload a deflection table as textures for the compute shader lookup mode
+	void uploadDeflectionTable(const DeflectionTable& table);
+	bool hasDeflectionTable() const;
+
+	// Bind the table textures to units 1 (paths) and 2 (entries) and set the table uniforms
+	void bindDeflectionTable(Shader& computeShader);
+
+	// Async readback of the compute texture through a ring of ringSize persistently mapped
+	// pixel pack buffers. A request copies the texture into the next buffer on the GPU and puts
+	// a fence behind it, the pixels are picked up a few frames later once the fence has passed.
+	void enableReadback(int ringSize = 3);
+	void disableReadback();
+	bool isReadbackEnabled() const;
+
+	// Queue a copy of the texture as it is now (call after the compute pass). Never waits:
+	// if every buffer is still in flight the request is dropped and false is returned.
+	bool requestReadback(uint64_t frame);
+
+	// Hand every finished readback to consumer, oldest first. Returns how many were handed over.
+	// wait = true blocks until all of them are done (for shutdown).
+	int collectReadbacks(const ReadbackConsumer& consumer, bool wait = false);
+
+	uint64_t getDroppedReadbacks() const;
+
 private:
-	GLuint computeTexture;
+	// One output texture of the ring
+	struct RenderTarget
+	{
+		GLuint texture = 0;
+		GLsync computeDone = nullptr;   // set by endCompute, cleared once renderQuad sees it passed
+		GLsync presentDone = nullptr;   // set when the quad sampled it, waited on before the next write
+	};
+	std::vector<RenderTarget> targets;
+	int writeTarget = 0;                // bound by bindForCompute
+	int latestTarget = -1;              // last one endCompute finished
+	int presentTarget = -1;             // shown by renderQuad
+
+	// Textures of an old size, deleted once their fence has passed
+	struct RetiredTexture
+	{
+		GLuint texture;
+		GLsync fence;
+	};
+	std::vector<RetiredTexture> retiredTextures;
+
+	GLuint accumulationTexture = 0;     // RGBA32F running sum of the jittered samples
+	GLuint deflectionPathTexture = 0;   // 3D: swept angle x impact x observer radius
+	GLuint deflectionEntryTexture = 0;  // 2D: impact x observer radius
+	float tableMinRadius = 0.0f;
+	float tableMaxRadius = 0.0f;
+	float tableMaxSweep = 0.0f;
+	int tableCrossings = 0;
+	GLuint coarseSampleBuffer = 0;      // one color + kind per tile corner (binding 2)
+	GLuint refineWorkListBuffer = 0;    // indirect dispatch args + mixed tile list (binding 3)
 	int width;
 	int height;
 	Mesh* quadMesh; // Pointer to manage lifetime
 
+	void createHierarchyBuffers();
+
+	// one slot of the readback ring
+	struct ReadbackSlot
+	{
+		GLuint buffer = 0;
+		const unsigned char* mapped = nullptr;
+		GLsync fence = nullptr;     // set while the copy is in flight
+		uint64_t frame = 0;
+	};
+	std::vector<ReadbackSlot> readbackSlots;
+	int readbackNext = 0;           // slot the next request goes into
+	int readbackOldest = 0;         // slot collected next
+	int readbacksInFlight = 0;
+	uint64_t droppedReadbacks = 0;
+
+	void createReadbackBuffers(int ringSize);
+	void deleteReadbackBuffers();
+
 	void createTexture();
+	void retireTextures();
+	void releaseRetiredTextures();
 	void setupTextureParameters();
 };
\ No newline at end of file
@@ -0,0 +1,330 @@
+#pragma once
+#include <PhysicsConstants.hpp>
+#include <algorithm>
+#include <cmath>
+
+//the 2D light ray integrators, written once as templates.
+//the scalar type (float for the app, double for validation runs near the horizon) and the
+//stepping scheme are both template parameters, so RayIntegrator<double, RK4> compiles down to
+//straight line code for that one combination: no virtual calls, no switch in the inner loop.
+//
+//a stepping policy is a class template over the scalar type with
+//  void advance(BasicRayState<T>& state, T deltaTime, T Rs, IntegratorStats& stats)
+//that moves the state forward by exactly deltaTime. fixed step schemes get advance() from
+//FixedStepPolicy and only write step(), the adaptive one sub-steps inside advance().
+
+// Settings for the adaptive (Dormand-Prince 5(4)) integrator
+struct AdaptiveStepSettings
+{
+	float tolerance = 1.0e-4f;   // allowed local error per step (relative, absolute for small values)
+	float minStep = 1.0e-4f;     // never go below this step
+	float maxStep = 2.0f;        // never go above this step
+	float maxStepPerRadius = 0.5f / static_cast<float>(C);  // far from the hole the step may grow up to this * r
+	float safety = 0.9f;         // how careful the next step size guess is
+};
+
+// Counters filled in by the integrators
+struct IntegratorStats
+{
+	unsigned long long acceptedSteps = 0;
+	unsigned long long rejectedSteps = 0;
+	unsigned long long derivativeEvaluations = 0;
+};
+
+template <typename T>
+struct BasicRayState
+{
+	T r;				//distance from black hole center
+	T theta;			//angle from the black hole center.(radians)
+	T dr_dlambda;		//radial velocity. (moving toward/away)
+	T dtheta_dlambda;	//angular velocity. (rotating around)
+
+	//For adding states together (for RK4 math)
+	BasicRayState operator+(const BasicRayState& other) const
+	{
+		return BasicRayState{
+			r + other.r,
+			theta + other.theta,
+			dr_dlambda + other.dr_dlambda,
+			dtheta_dlambda + other.dtheta_dlambda
+		};
+	}
+
+	// Allow multiplying state by a scalar (for RK4 math)
+	BasicRayState operator*(T scalar) const
+	{
+		return BasicRayState{
+			r * scalar,
+			theta * scalar,
+			dr_dlambda * scalar,
+			dtheta_dlambda * scalar
+		};
+	}
+};
+
+// Returns (dr/dlambda, dtheta/dlambda, d2r/dlambda2, d2theta/dlambda2) for the given state
+template <typename T>
+BasicRayState<T> geodesicDerivatives(const BasicRayState<T>& state, T Rs)
+{
+	const T c = static_cast<T>(C);
+
+	T r = state.r;
+	T dr = state.dr_dlambda;
+	T dtheta = state.dtheta_dlambda;
+
+	// Angular acceleration: d2theta/dlambda2 = -(2/r) * (dr/dlambda) * (dtheta/dlambda)
+	T d2theta_dlambda2 = -(T(2) / r) * dr * dtheta;
+
+	// Radial acceleration: d2r/dlambda2 = -(c^2 * Rs)/(2*r^2) + r*(dtheta/dlambda)^2
+	T d2r_dlambda2 = -(c * c * Rs) / (T(2) * r * r) + r * dtheta * dtheta;
+
+	return BasicRayState<T>{ dr, dtheta, d2r_dlambda2, d2theta_dlambda2 };
+}
+
+// ===== Fixed step policies =====
+
+// advance() for schemes that take exactly one step of deltaTime
+template <typename T, typename Derived>
+struct FixedStepPolicy
+{
+	void advance(BasicRayState<T>& state, T deltaTime, T Rs, IntegratorStats& stats) const
+	{
+		state = Derived::step(state, deltaTime, Rs);
+		stats.acceptedSteps++;
+		stats.derivativeEvaluations += Derived::evaluationsPerStep;
+	}
+};
+
+// Explicit Euler, first order. Only useful as the "how bad can it get" baseline.
+template <typename T>
+struct Euler : FixedStepPolicy<T, Euler<T>>
+{
+	static constexpr int evaluationsPerStep = 1;
+
+	static BasicRayState<T> step(const BasicRayState<T>& state, T deltaTime, T Rs)
+	{
+		return state + geodesicDerivatives(state, Rs) * deltaTime;
+	}
+};
+
+// Velocity Verlet, second order. The accelerations here also depend on the velocities, so the
+// acceleration at the end of the step is taken with a predicted (half step) velocity.
+template <typename T>
+struct VelocityVerlet : FixedStepPolicy<T, VelocityVerlet<T>>
+{
+	static constexpr int evaluationsPerStep = 2;
+
+	static BasicRayState<T> step(const BasicRayState<T>& state, T deltaTime, T Rs)
+	{
+		const T half = deltaTime / T(2);
+		BasicRayState<T> a0 = geodesicDerivatives(state, Rs);
+
+		// positions: x1 = x0 + v0*h + a0*h^2/2, velocities predicted to the half step
+		BasicRayState<T> next;
+		next.r = state.r + (state.dr_dlambda + a0.dr_dlambda * half) * deltaTime;
+		next.theta = state.theta + (state.dtheta_dlambda + a0.dtheta_dlambda * half) * deltaTime;
+		next.dr_dlambda = state.dr_dlambda + a0.dr_dlambda * half;
+		next.dtheta_dlambda = state.dtheta_dlambda + a0.dtheta_dlambda * half;
+
+		// velocities: v1 = v0 + (a0 + a1)*h/2
+		BasicRayState<T> a1 = geodesicDerivatives(next, Rs);
+		next.dr_dlambda = state.dr_dlambda + (a0.dr_dlambda + a1.dr_dlambda) * half;
+		next.dtheta_dlambda = state.dtheta_dlambda + (a0.dtheta_dlambda + a1.dtheta_dlambda) * half;
+		return next;
+	}
+};
+
+// Classic fourth order Runge-Kutta (same operation order as rk4Step in geodesic.comp)
+template <typename T>
+struct RK4 : FixedStepPolicy<T, RK4<T>>
+{
+	static constexpr int evaluationsPerStep = 4;
+
+	static BasicRayState<T> step(const BasicRayState<T>& initial, T deltaTime, T Rs)
+	{
+		BasicRayState<T> k1 = geodesicDerivatives(initial, Rs);
+		BasicRayState<T> k2 = geodesicDerivatives(initial + k1 * (deltaTime / T(2)), Rs);
+		BasicRayState<T> k3 = geodesicDerivatives(initial + k2 * (deltaTime / T(2)), Rs);
+		BasicRayState<T> k4 = geodesicDerivatives(initial + k3 * deltaTime, Rs);
+
+		// initial + (k1 + 2*k2 + 2*k3 + k4) * dt/6
+		return initial + (k1 + (k2 * T(2) + (k3 * T(2) + k4))) * (deltaTime / T(6));
+	}
+};
+
+// ===== Dormand-Prince 5(4) =====
+
+// Error of one component scaled by the tolerance (<= 1 means acceptable)
+template <typename T>
+T scaledStepError(T error, T before, T after, T tolerance)
+{
+	T scale = tolerance * (T(1) + std::max(std::abs(before), std::abs(after)));
+	return std::abs(error) / scale;
+}
+
+// Takes one accepted step starting with stepSize, shrinking and retrying until the error fits.
+// On return state is advanced, the return value is the step actually taken and
+// stepSize holds the suggested size for the next step.
+// The 5th order solution is used to advance (b5 weights are the same as the a7 row),
+// the difference to the embedded 4th order one is the error estimate.
+// stepCap > 0 is a hard limit on the step taken, even below settings.minStep (to land exactly on the end of a frame).
+template <typename T>
+T dormandPrinceStep(BasicRayState<T>& state, T& stepSize, T Rs, const AdaptiveStepSettings& settings,
+	IntegratorStats* stats = nullptr, T stepCap = T(0))
+{
+	// Butcher tableau
+	const T a21 = T(1) / T(5);
+	const T a31 = T(3) / T(40), a32 = T(9) / T(40);
+	const T a41 = T(44) / T(45), a42 = T(-56) / T(15), a43 = T(32) / T(9);
+	const T a51 = T(19372) / T(6561), a52 = T(-25360) / T(2187), a53 = T(64448) / T(6561), a54 = T(-212) / T(729);
+	const T a61 = T(9017) / T(3168), a62 = T(-355) / T(33), a63 = T(46732) / T(5247), a64 = T(49) / T(176),
+		a65 = T(-5103) / T(18656);
+	const T b1 = T(35) / T(384), b3 = T(500) / T(1113), b4 = T(125) / T(192), b5 = T(-2187) / T(6784), b6 = T(11) / T(84);
+	// error weights (5th order minus 4th order)
+	const T e1 = T(71) / T(57600), e3 = T(-71) / T(16695), e4 = T(71) / T(1920), e5 = T(-17253) / T(339200),
+		e6 = T(22) / T(525), e7 = T(-1) / T(40);
+
+	const T tolerance = static_cast<T>(settings.tolerance);
+	const T minStep = static_cast<T>(settings.minStep);
+	const T maxStep = static_cast<T>(settings.maxStep);
+	const T safety = static_cast<T>(settings.safety);
+
+	// Step growth is limited by the distance to the hole: big steps far away, small ones close in
+	T limit = std::min(maxStep, static_cast<T>(settings.maxStepPerRadius) * std::abs(state.r));
+	limit = std::max(limit, minStep);
+	T h = stepSize > T(0) ? std::clamp(stepSize, minStep, limit) : limit;
+	// the smallest step allowed, the cap wins over minStep
+	T floorStep = minStep;
+	if (stepCap > T(0))
+	{
+		h = std::min(h, stepCap);
+		floorStep = std::min(minStep, stepCap);
+	}
+
+	const BasicRayState<T> y = state;
+	BasicRayState<T> k1 = geodesicDerivatives(y, Rs);
+
+	while (true)
+	{
+		BasicRayState<T> k2 = geodesicDerivatives(y + k1 * (h * a21), Rs);
+		BasicRayState<T> k3 = geodesicDerivatives(y + (k1 * a31 + k2 * a32) * h, Rs);
+		BasicRayState<T> k4 = geodesicDerivatives(y + (k1 * a41 + k2 * a42 + k3 * a43) * h, Rs);
+		BasicRayState<T> k5 = geodesicDerivatives(y + (k1 * a51 + k2 * a52 + k3 * a53 + k4 * a54) * h, Rs);
+		BasicRayState<T> k6 = geodesicDerivatives(y + (k1 * a61 + k2 * a62 + k3 * a63 + k4 * a64 + k5 * a65) * h, Rs);
+		BasicRayState<T> y5 = y + (k1 * b1 + k3 * b3 + k4 * b4 + k5 * b5 + k6 * b6) * h;
+		BasicRayState<T> k7 = geodesicDerivatives(y5, Rs);
+
+		BasicRayState<T> errorState = (k1 * e1 + k3 * e3 + k4 * e4 + k5 * e5 + k6 * e6 + k7 * e7) * h;
+
+		T error = std::max({
+			scaledStepError(errorState.r, y.r, y5.r, tolerance),
+			scaledStepError(errorState.theta, y.theta, y5.theta, tolerance),
+			scaledStepError(errorState.dr_dlambda, y.dr_dlambda, y5.dr_dlambda, tolerance),
+			scaledStepError(errorState.dtheta_dlambda, y.dtheta_dlambda, y5.dtheta_dlambda, tolerance)
+		});
+
+		if (stats)
+		{
+			stats->derivativeEvaluations += 7;
+		}
+
+		// Accept (also accept if we can't shrink any further)
+		if (error <= T(1) || h <= floorStep)
+		{
+			T growth = error > T(0) ? safety * std::pow(error, T(-0.2)) : T(5);
+			growth = std::clamp(growth, T(0.2), T(5));
+			stepSize = std::clamp(h * growth, minStep, maxStep);
+
+			state = y5;
+			if (stats)
+			{
+				stats->acceptedSteps++;
+			}
+			return h;
+		}
+
+		// Reject: shrink and try again (NaN error shrinks as much as allowed)
+		if (stats)
+		{
+			stats->rejectedSteps++;
+		}
+		T shrink = std::isfinite(error) ? std::max(T(0.2), safety * std::pow(error, T(-0.25))) : T(0.2);
+		h = std::max(h * shrink, floorStep);
+	}
+}
+
+// Adaptive policy: as many Dormand-Prince sub-steps as the tolerance needs to cover deltaTime.
+// Remembers its step size between calls, so keep one per ray.
+template <typename T>
+struct AdaptiveDormandPrince
+{
+	AdaptiveStepSettings settings;
+	T nextStep = T(0);   // 0 = not picked yet
+
+	void advance(BasicRayState<T>& state, T deltaTime, T Rs, IntegratorStats& stats)
+	{
+		T remaining = deltaTime;
+		while (remaining > T(0) && state.r > Rs)
+		{
+			// Don't step past the end of the frame (remaining is a hard cap, so the last sub-step
+			// may be shorter than settings.minStep)
+			T stepSize = nextStep;
+			bool clipped = false;
+			if (stepSize <= T(0) || stepSize > remaining)
+			{
+				stepSize = remaining;
+				clipped = true;
+			}
+
+			T taken = dormandPrinceStep(state, stepSize, Rs, settings, &stats, remaining);
+			remaining = taken < remaining ? remaining - taken : T(0);
+
+			//a step cut short to land on the frame end says nothing about how big the next one can be,
+			//unless the error forced it even smaller
+			if (!clipped || nextStep <= T(0) || stepSize < nextStep)
+			{
+				nextStep = stepSize;
+			}
+		}
+	}
+};
+
+// ===== Integrator =====
+
+// One ray's integrator: scalar type T, stepping policy Policy (Euler, VelocityVerlet, RK4, AdaptiveDormandPrince)
+template <typename T, template <typename> class Policy>
+class RayIntegrator
+{
+public:
+	using State = BasicRayState<T>;
+
+	explicit RayIntegrator(T Rs, Policy<T> policy = Policy<T>()) : Rs(Rs), policy(policy) {}
+
+	// Move state forward by deltaTime
+	void advance(State& state, T deltaTime)
+	{
+		policy.advance(state, deltaTime, Rs, stats);
+	}
+
+	// Run until the ray has covered duration or fallen into the hole, returns false if it fell in
+	bool integrate(State& state, T duration, T deltaTime)
+	{
+		for (T time = T(0); time < duration; time += deltaTime)
+		{
+			advance(state, std::min(deltaTime, duration - time));
+			if (state.r <= Rs)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	const IntegratorStats& getStats() const { return stats; }
+	Policy<T>& getPolicy() { return policy; }
+
+private:
+	T Rs;
+	Policy<T> policy;
+	IntegratorStats stats;
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <glad/glad.h>
+#include <Camera.hpp>
+#include <Shader.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+//keeps traced lens maps around so orbiting the camera doesn't integrate a single ray.
+//the camera always looks at the hole, the hole is round and the sky and the disk don't change with the
+//azimuth, so what a pixel sees only depends on the camera's distance and elevation (and the fov and
+//image size). a lens map stores for every pixel what its ray hit (geodesic.comp u_pass 4 traces it),
+//turning it into colors is one texture read per pixel (u_pass 5). the maps are kept per
+//radius/elevation bucket, least recently used ones go once the memory budget is full.
+
+struct LensMapSettings
+{
+	float radiusStep = 0.005f;      // bucket width in radius, relative (log spaced, 0.5%)
+	float elevationStep = 0.005f;   // bucket width in elevation, radians (one pixel of mouse drag)
+};
+
+struct LensMapKey
+{
+	int radiusBucket = 0;
+	int elevationBucket = 0;
+	float fov = 0.0f;
+	int width = 0;
+	int height = 0;
+
+	bool operator==(const LensMapKey& other) const = default;
+};
+
+struct LensMapKeyHash
+{
+	size_t operator()(const LensMapKey& key) const;
+};
+
+class LensMapCache
+{
+public:
+	LensMapCache(size_t maxBytes, const LensMapSettings& settings = LensMapSettings());
+	~LensMapCache();
+
+	LensMapCache(const LensMapCache&) = delete;
+	LensMapCache& operator=(const LensMapCache&) = delete;
+
+	LensMapKey keyFor(const Camera& camera, int width, int height) const;
+
+	// The camera a map is traced from: the middle of the key's buckets, camera's azimuth and target
+	Camera bucketCamera(const LensMapKey& key, const Camera& camera) const;
+
+	// The map for key (and marks it as just used), 0 if it isn't cached
+	GLuint find(const LensMapKey& key);
+
+	// Make room for and create an empty map for key (after find() missed), 0 if one map alone is
+	// over the budget. Fill it with trace() before using it.
+	GLuint insert(const LensMapKey& key);
+
+	// Trace every pixel into map (needs the FrameParams block for bucketCamera bound)
+	void trace(Shader& computeShader, GLuint map, int width, int height);
+
+	// Shade the frame from map into the images Graphics::bindForCompute bound (writes sample 0)
+	void shade(Shader& computeShader, GLuint map, int width, int height);
+
+	// Drop every map (the black hole changed)
+	void clear();
+
+	size_t getMapCount() const;
+	size_t memoryBytes() const;
+	uint64_t getHits() const;
+	uint64_t getMisses() const;
+	uint64_t getEvictions() const;
+
+private:
+	struct Entry
+	{
+		LensMapKey key;
+		GLuint texture = 0;
+		size_t bytes = 0;
+	};
+
+	LensMapSettings settings;
+	size_t maxBytes;
+	size_t usedBytes = 0;
+
+	// most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<LensMapKey, std::list<Entry>::iterator, LensMapKeyHash> index;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+
+	void evictLeastRecent();
+	static size_t mapBytes(int width, int height);
+	void dispatch(Shader& computeShader, int pass, GLuint map, GLenum access, int width, int height);
+};
@@ -7,30 +7,67 @@
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
+//a vertex array with its buffers, set up with direct state access (nothing is bound to edit it).
+//the vertex and index data go into immutable storage, they can't change after the constructor.
+//per instance data lives in a separate buffer on binding point 1 (setInstanceData), so the same
+//mesh can be drawn many times (markers, particles ...) with a single draw call.
+
+// Vertex buffer binding points used by every Mesh VAO
+const GLuint meshVertexBinding = 0;
+const GLuint meshInstanceBinding = 1;
+
 class Mesh
 {
 	public:
 	unsigned int VAO, VBO;
+	unsigned int EBO = 0;     // only for indexed meshes
+	unsigned int instanceVBO = 0;  // only after setInstanceData
 	GLsizei vertexCount;
+	GLsizei indexCount = 0;
+	GLsizei instanceCount = 0;
 	//constructor
-	Mesh(float* vertices, size_t size, GLsizei count,
+	Mesh(const float* vertices, size_t size, GLsizei count,
+		const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride);
+	// Indexed mesh: the draw calls use indices instead of walking the vertices in order
+	Mesh(const float* vertices, size_t size, GLsizei count, const std::vector<GLuint>& indices,
 		const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride);
+	~Mesh();
+
+	// Owns GL objects: move only
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+	Mesh(Mesh&& other) noexcept;
+	Mesh& operator=(Mesh&& other) noexcept;
 
 	void draw();
 	void draw_Circle();
 	void draw_Lines();  // For rendering grid as lines
 
+	// Per instance attributes (same {location, floats} layout as the constructor, all floats),
+	// they advance once per instance instead of once per vertex. maxInstances sets the buffer size
+	// for good, updateInstanceData can then rewrite up to that many.
+	void setInstanceData(const float* data, GLsizei count, GLsizei maxInstances,
+		const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride);
+	void updateInstanceData(const float* data, GLsizei count);
+
+	// Draw every instance set with setInstanceData in one call (mode = GL_TRIANGLES, GL_LINES ...)
+	void drawInstanced(GLenum mode);
+
 	static std::vector<float> generateCircleVertices(float radius, int segments);
 
 	static std::vector<float> generateQuadVertices();
 
-	// Generate a 3D grid mesh for spacetime visualization
-	static std::vector<float> generateGridVertices(float size, int divisions);
-
 	void setColor(glm::vec4 color_in);
 	glm::vec4 getColor();
 
 	private:
 		glm::vec4 color;
-};
+		GLsizei instanceStride = 0;
+		GLsizei maxInstanceCount = 0;
 
+		void createVertexArray(const float* vertices, size_t size,
+			const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride);
+		void setupAttributes(GLuint binding, const std::vector<std::pair<GLuint, GLint>>& attributes);
+		void submit(GLenum mode, GLsizei instances);
+		void release();
+};
@@ -0,0 +1,87 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <BlackHole.hpp>
+#include <Shader.hpp>
+#include <cstdint>
+#include <vector>
+
+//a stream of 2D photons that lives entirely on the GPU.
+//photons.comp holds every photon's polar state and a short trail ring in shader storage buffers and
+//steps them with the same RK4 as geodesic.comp, photons.vert draws the trails straight out of those
+//buffers (no vertex buffer, nothing read back or uploaded per frame). photons that fall in or leave
+//the scene start over at their spawn state, and the first start times are spread out, so a fan of
+//a million photons turns into a steady stream around the hole.
+
+// Outcome of PhotonSystem::checkAgainstCpu
+struct PhotonCheck
+{
+	size_t checked = 0;
+	size_t agreeing = 0;       // relative difference in r below the tolerance
+	float maxDifference = 0.0f; // largest relative difference in r among the agreeing ones
+};
+
+// How the photons leave the source
+struct PhotonSettings
+{
+	glm::vec2 source = glm::vec2(100.0f, 300.0f);
+	float spreadAngle = glm::radians(60.0f);  // total fan width, centred on +x
+	float speed = 70.0f;                      // like the --trails fan
+	size_t trailCapacity = 16;                // points per trail (at least 2)
+	float escapeRadius = 1000.0f;             // start over once this far from the hole
+	uint32_t maxWaitSteps = 300;              // first starts are spread over this many steps
+	unsigned int seed = 1234u;                // for the start times
+};
+
+class PhotonSystem
+{
+public:
+	PhotonSystem(size_t photonCount, const BlackHole& blackHole, const PhotonSettings& settings = PhotonSettings());
+	~PhotonSystem();
+
+	PhotonSystem(const PhotonSystem&) = delete;
+	PhotonSystem& operator=(const PhotonSystem&) = delete;
+
+	// Put every photon back at the source with its first wait (the state right after the constructor)
+	void reset();
+
+	// Run `steps` RK4 steps of deltaTime each with photons.comp (needs the FrameParams block bound)
+	void step(Shader& computeShader, float deltaTime, int steps = 1);
+
+	// Draw every trail with photons.vert/photons.frag, blended additively
+	void draw(Shader& drawShader, const glm::mat4& projection, glm::vec4 color);
+
+	// Waits for the GPU and copies the photon states back (r, theta, dr/dlambda, dtheta/dlambda), for checks
+	std::vector<glm::vec4> readStates() const;
+	// Reset, run `steps` steps on the GPU, then replay every sampleStride-th photon on the CPU with
+	// rk4Step (waits and restarts included) and compare. Photons that graze the capture edge can end up
+	// on either side of it, so a handful may disagree. Needs the FrameParams block bound. Resets again after.
+	PhotonCheck checkAgainstCpu(Shader& computeShader, const BlackHole& blackHole, float deltaTime, int steps,
+		size_t sampleStride = 1, float tolerance = 1.0e-3f);
+
+	// Start states and first waits the constructor made up
+	const std::vector<RayState>& getSpawns() const;
+	const std::vector<uint32_t>& getWaits() const;
+
+	size_t getPhotonCount() const;
+	// Vertices one draw() call sends (2 per trail segment)
+	size_t getVertexCount() const;
+	size_t memoryBytes() const;
+
+	// Storage buffers the vertex stage can use: photons.vert declares all 3 blocks of PhotonBuffers.glsl
+	// (it only reads photons and trails, but a driver may still count the spawns block), so it needs 3
+	static bool isSupported();
+
+private:
+	size_t photonCount;
+	PhotonSettings settings;
+	std::vector<RayState> spawns;
+	std::vector<uint32_t> waits;
+
+	GLuint photonBuffer = 0;
+	GLuint spawnBuffer = 0;
+	GLuint trailBuffer = 0;
+	GLuint emptyVAO = 0;   // core profile needs a VAO bound to draw, the vertices come from the buffers
+
+	void bindBuffers() const;
+};
@@ -0,0 +1,5 @@
+#pragma once
+
+//physics constants
+const double G = 1.0;           // Gravitational constant (pixel units)
+const double C = 100.0;         // Speed of light (pixels/second)
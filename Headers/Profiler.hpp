@@ -0,0 +1,121 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//frame profiler: named zones timed on the CPU (steady_clock) and on the GPU (GL_TIMESTAMP queries).
+//the GPU answers come back a few frames late, so every frame gets its own set of query objects
+//in a ring of frameLatency frames. a frame's results are only read when its slot comes round
+//again, and only if they're ready. if they aren't the frame is dropped instead of waiting.
+//
+//zones can nest, names must be string literals (they're stored as pointers).
+
+// One finished zone of one frame
+struct ProfileRecord
+{
+	uint64_t frame;
+	const char* name;
+	int depth;        // 0 = the whole frame, 1 = zones directly inside it ...
+	double cpuMs;
+	double gpuMs;     // -1 if no GPU time (GPU timers off or out of queries)
+};
+
+// Rolling average of one zone
+struct ProfileSummary
+{
+	const char* name;
+	int depth;
+	double cpuMs;
+	double gpuMs;
+};
+
+class Profiler
+{
+public:
+	// gpuTimers = false only times the CPU side (no GL context needed)
+	Profiler(bool gpuTimers = true, int frameLatency = 4, int maxZonesPerFrame = 16);
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// A frame is a zone called "frame" around everything else
+	void beginFrame();
+	void endFrame();
+
+	void beginZone(const char* name);
+	void endZone();
+
+	// Wait for the frames still in flight and collect them (for shutdown, this one does stall)
+	void flush();
+
+	// Every zone finished so far (GPU results arrive frameLatency frames late)
+	const std::vector<ProfileRecord>& getRecords() const;
+	const std::vector<ProfileSummary>& getSummary() const;
+	uint64_t getDroppedFrames() const;
+
+	// One line summary, e.g. "frame 4.10 ms (gpu 3.90) | geodesic 3.20 ms (gpu 3.10) ..."
+	std::string summaryText() const;
+
+	// Write every record, the format is picked from the extension (.json, anything else is CSV)
+	bool writeFile(const std::string& filePath) const;
+	bool writeCSV(const std::string& filePath) const;
+	bool writeJSON(const std::string& filePath) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct PendingZone
+	{
+		const char* name;
+		int depth;
+		Clock::time_point cpuBegin;
+		double cpuMs;
+		int queryPair;    // index into the slot's queries (begin = 2i, end = 2i + 1), -1 = none
+	};
+
+	struct FrameSlot
+	{
+		uint64_t frame = 0;
+		bool pending = false;             // finished, waiting for the GPU results
+		std::vector<PendingZone> zones;
+		std::vector<GLuint> queries;      // 2 * maxZonesPerFrame timestamp queries
+		int usedPairs = 0;
+	};
+
+	bool gpuTimers;
+	int maxZonesPerFrame;
+	std::vector<FrameSlot> slots;
+	int currentSlot = 0;
+	uint64_t frameIndex = 0;
+	uint64_t droppedFrames = 0;
+
+	std::vector<int> openZones;           // indices into the current slot's zones
+	std::vector<ProfileRecord> records;
+	std::vector<ProfileSummary> summary;
+
+	void collect(FrameSlot& slot, bool wait);
+	void addToSummary(const ProfileRecord& record);
+};
+
+// Times the enclosing scope, does nothing if profiler is null
+class ProfileZone
+{
+public:
+	ProfileZone(Profiler* profiler, const char* name) : profiler(profiler)
+	{
+		if (profiler) profiler->beginZone(name);
+	}
+	~ProfileZone()
+	{
+		if (profiler) profiler->endZone();
+	}
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	Profiler* profiler;
+};
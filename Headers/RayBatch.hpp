@@ -0,0 +1,122 @@
+#pragma once
+#include <BlackHole.hpp>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+class ThreadPool;
+
+//a structure-of-arrays batch of 2D light rays.
+//instead of one LightRay struct per ray (with its own trail vector) every field lives in its
+//own tightly packed array, so the RK4 kernel can step 8 (AVX2) or 16 (AVX-512) rays at once.
+//cartesian positions are not stored, they're only worked out (with sin/cos) when asked for.
+
+// Which kernel RayBatch::step runs
+enum class SimdLevel
+{
+	Scalar,
+	AVX2,
+	AVX512
+};
+
+// Best level supported by this CPU (checked once, at runtime)
+SimdLevel detectSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// Allocator that hands out 64 byte aligned memory (one cache line / one AVX-512 register)
+template <typename T>
+struct AlignedAllocator
+{
+	using value_type = T;
+	static constexpr std::align_val_t alignment{ 64 };
+
+	AlignedAllocator() = default;
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U>&) {}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(::operator new(count * sizeof(T), alignment));
+	}
+	void deallocate(T* pointer, size_t)
+	{
+		::operator delete(pointer, alignment);
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U>&) const { return true; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Raw pointers to the lanes, handed to the kernels
+struct RayBatchLanes
+{
+	float* r;
+	float* theta;
+	float* dr_dlambda;
+	float* dtheta_dlambda;
+	uint32_t* active;     // 0xFFFFFFFF = still travelling, 0 = crossed the event horizon
+};
+
+class RayBatch
+{
+public:
+	// Lane count every array is padded to (one AVX-512 register)
+	static constexpr size_t laneWidth = 16;
+	// Rays per chunk when stepping over a ThreadPool (big enough that taking a chunk costs nothing next to running it)
+	static constexpr size_t defaultChunkRays = 2048;
+
+	RayBatch() = default;
+	explicit RayBatch(size_t capacity);
+
+	void reserve(size_t capacity);
+	void clear();
+
+	size_t size() const;
+
+	// Add a ray the same way LightRay::initialize sets one up. Returns its index.
+	size_t addRay(glm::vec2 startPos, glm::vec2 startVel, const BlackHole& blackHole);
+	// Copy the state of an existing ray
+	size_t addRay(const LightRay& ray);
+
+	// Step every active ray forward with RK4 using the best kernel for this CPU
+	void step(float deltaTime, const BlackHole& blackHole);
+	// Same, with a chosen kernel (falls back to scalar if the CPU can't run it)
+	void step(float deltaTime, const BlackHole& blackHole, SimdLevel level);
+	// Same, spread over a pool in chunks of raysPerChunk rays (rounded up to a multiple of laneWidth).
+	// Rays die at very different times, so idle threads steal chunks from the busy ones.
+	void step(float deltaTime, const BlackHole& blackHole, ThreadPool& pool, size_t raysPerChunk = defaultChunkRays);
+	// Step only rays in [begin, end). begin should be a multiple of laneWidth.
+	void stepRange(size_t begin, size_t end, float deltaTime, const BlackHole& blackHole, SimdLevel level);
+
+	bool isActive(size_t index) const;
+	size_t countActive() const;
+
+	RayState getState(size_t index) const;
+	// Cartesian position of a ray (only computed here, not every step)
+	glm::vec2 getPosition(size_t index, const BlackHole& blackHole) const;
+
+	RayBatchLanes lanes();
+
+private:
+	size_t count = 0;
+
+	AlignedVector<float> r;
+	AlignedVector<float> theta;
+	AlignedVector<float> dr_dlambda;
+	AlignedVector<float> dtheta_dlambda;
+	AlignedVector<uint32_t> active;
+
+	void resizeLanes(size_t paddedCount);
+};
+
+//kernels, one per instruction set. Each one lives in its own .cpp so it can be
+//compiled with the matching compiler flags (see CmakeLists.txt).
+//they step lanes [begin, end) and leave inactive lanes untouched.
+void stepRayBatchScalar(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs);
+void stepRayBatchAVX2(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs);
+void stepRayBatchAVX512(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs);
@@ -0,0 +1,74 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <BlackHole.hpp>
+#include <RayBatch.hpp>
+#include <ThreadPool.hpp>
+#include <TripleBuffer.hpp>
+
+//steps a RayBatch on its own thread at a fixed timestep, paced by the real clock, so a slow frame
+//doesn't slow the rays down and a slow physics step doesn't drop frames.
+//after every step the ray positions go out as a snapshot through a TripleBuffer, the render thread
+//picks up the newest one whenever it draws (never waits) and blends the last two, so the rays
+//move smoothly even when the simulation runs slower than the window.
+
+// Ray positions after one simulation step
+struct RaySnapshot
+{
+	uint64_t tick = 0;           // steps done when this was taken
+	double time = 0.0;           // steady clock time (seconds) the positions belong to
+	std::vector<glm::vec2> positions;
+	std::vector<uint8_t> active; // 0 once the ray crossed the event horizon
+};
+
+class RaySimulation
+{
+public:
+	// Takes over the rays, every step moves them stepSeconds forward (real seconds = simulation time).
+	// threadCount: threads sharing each step (the simulation thread + pool workers, 0 = every core)
+	RaySimulation(RayBatch rays, const BlackHole& blackHole, double stepSeconds, unsigned threadCount = 1);
+
+	// Destructor: stops the thread
+	~RaySimulation();
+
+	RaySimulation(const RaySimulation&) = delete;
+	RaySimulation& operator=(const RaySimulation&) = delete;
+
+	void start();
+	void stop();
+
+	// Render thread: positions at the current time, blended between the last two snapshots.
+	// Never blocks. Returns false (and leaves the vectors alone) before the first step.
+	bool sample(std::vector<glm::vec2>& positions, std::vector<uint8_t>& active);
+
+	size_t size() const;
+	double getStepSeconds() const;
+	uint64_t getTicks() const;
+	// Steps thrown away because the thread fell too far behind the clock
+	uint64_t getDroppedTicks() const;
+
+	// Seconds on the clock the snapshots are stamped with
+	static double clockSeconds();
+
+private:
+	void run();
+	void takeSnapshot(RaySnapshot& snapshot, uint64_t tick, double time) const;
+
+	RayBatch rays;
+	BlackHole blackHole;
+	double stepSeconds;
+	std::unique_ptr<ThreadPool> pool;   // only with more than one thread
+
+	TripleBuffer<RaySnapshot> snapshots;
+	RaySnapshot previous;        // render thread: the snapshot before snapshots.readBuffer()
+	bool hasSnapshot = false;    // render thread
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<uint64_t> ticks{ 0 };
+	std::atomic<uint64_t> droppedTicks{ 0 };
+};
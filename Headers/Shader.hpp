@@ -7,6 +7,15 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
+
+// One stage of a program: its type (GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER) and source
+struct ShaderStage
+{
+	GLenum type;
+	std::string code;
+};
 
 class Shader
 {
@@ -17,6 +26,19 @@ class Shader
 	//constructor for computeshader
 	Shader(const std::string& computeCode, bool isCompute);
 
+	//starts building a program without waiting for the driver, Finish() must be called before it's used.
+	//with parallel compile on (EnableParallelCompile) every program started like this compiles at
+	//the same time, and the caller can get on with other startup work in the meantime.
+	explicit Shader(const std::vector<ShaderStage>& stages);
+
+	// Wait for the build, print compile/link errors and store the binary in the program cache.
+	// Returns true if the program linked. Calling it again does nothing.
+	bool Finish();
+	// True once Finish() won't have to wait (asks the driver, always true without parallel compile)
+	bool IsBuildDone() const;
+	// True if the program came out of the program cache instead of being compiled
+	bool IsFromCache() const { return fromCache; }
+
 	//bind shaders
 	void Use() const;
 	GLuint GetID() const { return shaderProgramID; }
@@ -31,10 +53,47 @@ class Shader
 	void SetVec4(const std::string& name, const glm::vec4& value) const;
 	void SetMat4(const std::string& name, const glm::mat4& mat) const;
 
+	// Location of a uniform, looked up once and then cached (-1 if the program doesn't use it)
+	GLint GetUniformLocation(const std::string& name) const;
+
 	//helper function.
+	//lines like #include "FrameParams.glsl" are replaced by that file (looked up next to filePath)
 	static std::string LoadShaderFromFile(const std::string& filePath);
 
+	// Source of a shader by file name ("geodesic.comp"), #includes expanded. Comes from the copy
+	// built into the executable, or from the source directory if one was set.
+	static std::string LoadShader(const std::string& name);
+	// "" = use the built in sources (the default), anything else = read the files from there
+	static void SetSourceDirectory(const std::string& directory);
+
+	// Where linked programs are saved (glGetProgramBinary) and loaded from next time, "" = off.
+	// The file name is a hash of the driver and the sources, so a driver update or a shader edit
+	// just misses the cache. Needs a GL context.
+	static void SetProgramCacheDirectory(const std::string& directory);
+
+	// Let the driver compile on its own threads (GL_KHR/ARB_parallel_shader_compile). False if it can't.
+	static bool EnableParallelCompile();
+
 	private:
-		GLuint shaderProgramID;
+		GLuint shaderProgramID = 0;
+
+		// build state between the constructor and Finish()
+		std::vector<ShaderStage> pendingStages;   // kept in case the cached binary is refused
+		std::vector<GLuint> pendingShaders;
+		std::string cacheKey;                     // "" = not cached
+		bool pending = false;
+		bool fromCache = false;
+
+		// Start a build: load the cached binary if there is one, otherwise compile + link (no waiting)
+		void startBuild(const std::vector<ShaderStage>& stages);
+		void compileAndLink();
+		bool loadCachedBinary();
+		void saveCachedBinary() const;
+
+		// uniform name -> location, filled in lazily by GetUniformLocation
+		mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+		// Point the FrameParams block (if the program has one) at frameParamsBinding
+		void bindFrameParams() const;
 
 };
\ No newline at end of file
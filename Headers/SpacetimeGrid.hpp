@@ -0,0 +1,50 @@
+#pragma once
+#include <Mesh.hpp>
+#include <vector>
+
+//the warped spacetime grid, drawn with grid.vert/grid.frag.
+//grid.vert pulls every vertex down by warpStrength * Rs / distance, so a grid line only looks smooth
+//where it has enough vertices to follow that curve. instead of one dense grid (which grows with
+//divisions^2) each grid line is cut into pieces whose length follows the curvature of the funnel:
+//short near the hole, a whole cell at the rim. a few levels of detail with growing tolerance are
+//built up front and the one matching the camera distance is drawn.
+
+// One level of detail
+struct GridLevel
+{
+	Mesh mesh;
+	float tolerance;          // largest gap between a grid line and the real funnel (world units)
+	size_t vertexCount;
+	size_t indexCount;
+};
+
+class SpacetimeGrid
+{
+public:
+	// size: edge length, divisions: cells per side, warpStrength and Rs: u_warpStrength and u_Rs of grid.vert
+	// levels: level i is built for tolerance baseTolerance * 2^i
+	SpacetimeGrid(float size, int divisions, float warpStrength, float Rs, int levels = 4, float baseTolerance = 0.25f);
+
+	// Picks the level for this camera distance from the hole and draws it as lines
+	void draw(float cameraDistance);
+
+	// Level draw() would use now (switches a little late in both directions so it doesn't flicker)
+	int selectLevel(float cameraDistance);
+
+	int getLevelCount() const;
+	const GridLevel& getLevel(int level) const;
+	// Vertices the plain grid would need for level 0's tolerance everywhere (its spacing at the horizon)
+	size_t getUniformVertexCount() const;
+
+private:
+	float size;
+	int divisions;
+	float funnelDepth;   // warpStrength * Rs
+	float Rs;
+	std::vector<GridLevel> levels;
+	int currentLevel = 0;
+
+	// Length of a line piece around a point distance away from the hole, for the given tolerance
+	float spacingAt(float distance, float tolerance) const;
+	void buildLevel(float tolerance, std::vector<float>& vertices, std::vector<GLuint>& indices);
+};
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//a small fixed size pool of worker threads with work stealing.
+//a job is a range [0, count) cut into chunks. every thread (including the caller) starts with its own
+//deque holding an equal, contiguous share of the chunks and takes them from the front. a thread that
+//runs out steals the back half of another thread's deque, so when some chunks are much cheaper than
+//others (dead rays, empty sky tiles) the idle threads take over from the busy ones.
+class ThreadPool
+{
+public:
+	//threadCount = 0 means "use every hardware thread"
+	explicit ThreadPool(unsigned threadCount = 0);
+
+	// Destructor: stops and joins the workers
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Total number of threads working on a job (workers + calling thread)
+	unsigned getThreadCount() const;
+
+	// Run task(i) for every i in [0, count) and block until all of them are done.
+	// The second argument is the index of the thread running the task (0 = caller).
+	void parallelFor(size_t count, const std::function<void(size_t index, unsigned threadIndex)>& task);
+
+	// Run task(begin, end, threadIndex) over [0, count) in chunks of chunkSize indices (the last one
+	// can be shorter) and block until all of them are done. A single chunk runs on the calling thread.
+	void parallelForRange(size_t count, size_t chunkSize,
+		const std::function<void(size_t begin, size_t end, unsigned threadIndex)>& task);
+
+	// Ranges of chunks taken from another thread's deque since the pool was made
+	unsigned long long getStealCount() const;
+
+private:
+	// Chunks [front, back) a thread still has to run, packed in one atomic so the owner taking
+	// from the front and thieves cutting off the back never need a lock
+	struct alignas(64) WorkDeque
+	{
+		std::atomic<uint64_t> range{ 0 };
+	};
+
+	void workerLoop(unsigned threadIndex);
+	void runTasks(unsigned threadIndex);
+	bool popChunk(unsigned threadIndex, size_t& chunk);
+	bool stealChunk(unsigned threadIndex, size_t& chunk);
+	void runChunk(size_t chunk, unsigned threadIndex);
+
+	std::vector<std::thread> workers;
+	std::unique_ptr<WorkDeque[]> deques;     // one per thread, [0] belongs to the caller
+	std::mutex mutex;
+	std::condition_variable wakeCondition;   // workers wait here for a new job
+	std::condition_variable doneCondition;   // caller waits here for the job to finish
+
+	const std::function<void(size_t, size_t, unsigned)>* currentTask = nullptr;
+	size_t taskCount = 0;
+	size_t taskChunkSize = 1;
+	unsigned busyWorkers = 0;
+	unsigned long long jobGeneration = 0;
+	bool stopping = false;
+	std::atomic<unsigned long long> stealCount{ 0 };
+};
@@ -0,0 +1,97 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class RayBatch;
+struct BlackHole;
+
+//trail storage for many rays in one block of memory.
+//every ray owns a fixed size ring of points inside a single shared allocation,
+//so memory is rayCount * capacityPerRay points no matter how long the simulation runs,
+//and nothing is allocated after setup. When a ring is full the oldest point is dropped.
+
+struct TrailSettings
+{
+	size_t capacityPerRay = 128;  // points kept per ray
+
+	// Decimation: a new point is only kept if the path turned by at least this angle (radians)
+	// since the last kept segment, otherwise it just moves the last point forward.
+	// 0 keeps every point.
+	float minTurnAngle = 0.0f;
+};
+
+// The points of one trail, oldest first. A ring can wrap, so it comes in up to two pieces.
+struct TrailView
+{
+	const glm::vec2* first = nullptr;
+	size_t firstCount = 0;
+	const glm::vec2* second = nullptr;
+	size_t secondCount = 0;
+
+	size_t size() const { return firstCount + secondCount; }
+};
+
+class TrailArena
+{
+public:
+	TrailArena() = default;
+	TrailArena(size_t rayCount, const TrailSettings& settings = TrailSettings());
+
+	// Set up for rayCount rays (only allocates if it needs more memory than before)
+	void reset(size_t rayCount, const TrailSettings& settings);
+
+	size_t getRayCount() const;
+	size_t getCapacityPerRay() const;
+	const TrailSettings& getSettings() const;
+
+	// Bytes used by the points and ring headers
+	size_t memoryBytes() const;
+
+	void clear(size_t ray);
+	void clearAll();
+
+	// Append a point to a ray's trail (may replace the last point, see TrailSettings::minTurnAngle)
+	void push(size_t ray, glm::vec2 point);
+
+	// Record the current position of every active ray in a batch (ray i goes to trail i)
+	void record(const RayBatch& batch, const BlackHole& blackHole);
+
+	size_t size(size_t ray) const;
+	// i = 0 is the oldest point
+	glm::vec2 at(size_t ray, size_t i) const;
+	glm::vec2 back(size_t ray) const;
+	TrailView view(size_t ray) const;
+
+	// Direct access to the whole arena (capacityPerRay points per ray, back to back)
+	const glm::vec2* data() const;
+
+private:
+	struct Ring
+	{
+		uint32_t head;   // slot of the oldest point
+		uint32_t count;  // points stored
+	};
+
+	TrailSettings settings;
+	size_t rayCount = 0;
+	float minTurnCos = 1.0f;
+
+	std::vector<glm::vec2> points;  // rayCount * capacityPerRay, one allocation
+	std::vector<Ring> rings;
+
+	size_t slot(size_t ray, const Ring& ring, size_t i) const;
+};
+
+// Handle to one ray's trail inside an arena (a LightRay without an arena keeps no trail)
+struct TrailHandle
+{
+	TrailArena* arena = nullptr;
+	size_t index = 0;
+
+	void push(glm::vec2 point) const;
+	void clear() const;
+	size_t size() const;
+	TrailView view() const;
+};
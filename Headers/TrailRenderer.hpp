@@ -0,0 +1,50 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <Shader.hpp>
+#include <TrailArena.hpp>
+#include <vector>
+
+//draws every trail in a TrailArena with a single glMultiDrawArrays call.
+//the points are streamed into one persistently mapped vertex buffer that is split into a few
+//sections used round robin (a ring). each section gets a fence when it's drawn, and we only
+//write into it again once the GPU is done with it, so there is no glBufferData, no VAO churn
+//and no allocation per frame.
+
+class TrailRenderer
+{
+public:
+	// maxVertices: most trail points one frame can hold (usually rayCount * capacityPerRay)
+	// sections: frames that can be in flight before we have to wait for the GPU
+	TrailRenderer(size_t maxVertices, int sections = 3);
+	~TrailRenderer();
+
+	TrailRenderer(const TrailRenderer&) = delete;
+	TrailRenderer& operator=(const TrailRenderer&) = delete;
+
+	// Stream every trail with at least 2 points and draw them all as line strips (uses main.vert/main.frag)
+	void draw(const TrailArena& trails, Shader& shader, const glm::mat4& projection, glm::vec4 color);
+
+	// What the last draw() sent
+	size_t getLastVertexCount() const;
+	GLsizei getLastDrawCount() const;
+
+private:
+	GLuint VAO = 0;
+	GLuint VBO = 0;
+	glm::vec2* mapped = nullptr;   // the whole buffer, stays mapped until the destructor
+
+	size_t sectionVertices;
+	int sectionCount;
+	int currentSection = 0;
+	std::vector<GLsync> fences;    // one per section, null when the section is free
+
+	// glMultiDrawArrays arguments, kept between frames so they don't reallocate
+	std::vector<GLint> firsts;
+	std::vector<GLsizei> counts;
+
+	size_t lastVertexCount = 0;
+	bool warnedOverflow = false;
+
+	void waitForSection(int section);
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//hands the newest value from one writer thread to one reader thread without locks or waiting.
+//there are three slots: the writer fills its own back slot, the reader looks at its own front slot,
+//and the third one sits in the middle. publish() swaps the back slot with the middle one,
+//update() swaps the middle one with the front slot if something new was published since.
+//neither side ever waits for the other, the reader just skips values it was too slow to see.
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() = default;
+
+	// Same starting value in every slot (e.g. vectors sized up front, so nothing allocates later)
+	explicit TripleBuffer(const T& initial)
+		: slots{ initial, initial, initial }
+	{
+	}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	// Writer: the slot to fill next. Only the writer touches it until publish().
+	T& writeBuffer()
+	{
+		return slots[back];
+	}
+
+	// Writer: hand the filled slot to the reader and get an old one back to fill
+	void publish()
+	{
+		uint8_t previous = middle.exchange(static_cast<uint8_t>(back | freshBit), std::memory_order_acq_rel);
+		back = previous & indexMask;
+	}
+
+	// Reader: true if a value was published that update() hasn't picked up yet
+	bool hasUpdate() const
+	{
+		return (middle.load(std::memory_order_acquire) & freshBit) != 0;
+	}
+
+	// Reader: swap in the newest published value. Returns false (and keeps the old one) if there is none.
+	bool update()
+	{
+		if (!hasUpdate())
+		{
+			return false;
+		}
+		uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+		front = previous & indexMask;
+		return true;
+	}
+
+	// Reader: the value picked up by the last update(). Stays put until the next update().
+	const T& readBuffer() const
+	{
+		return slots[front];
+	}
+
+	// Reader: the front slot is the reader's own until the next update(), so it may also swap its
+	// contents out (whatever is left in it goes back to the writer, which has to overwrite all of it)
+	T& readBuffer()
+	{
+		return slots[front];
+	}
+
+private:
+	static constexpr uint8_t indexMask = 0x3;
+	static constexpr uint8_t freshBit = 0x4;
+
+	std::array<T, 3> slots;
+	// slot index in the middle, plus freshBit while the reader hasn't taken it yet
+	std::atomic<uint8_t> middle{ 1 };
+	uint8_t back = 0;    // writer only
+	uint8_t front = 2;   // reader only
+};
@@ -0,0 +1,9 @@
+// Density grid of the caustic map (see Headers/CausticRenderer.hpp).
+// caustics.comp counts into it with atomic adds, caustics.frag shows it log scaled.
+
+layout(std430, binding = 7) buffer CausticBins {
+    uint bins[];       // u_gridSize.x * u_gridSize.y cells, row by row, bottom row first
+};
+
+uniform ivec2 u_gridSize;
+uniform vec2 u_sceneSize;   // scene units the grid covers, from (0, 0)
@@ -0,0 +1,47 @@
+// Disk plane crossing inside one integration step.
+// Shared by Shaders/geodesic.comp (#include "DiskCrossing.glsl") and src/CpuRenderer.cpp, which
+// includes this file with glm's vec2/vec3 in scope. So only write what is both GLSL and C++ here:
+// float literals with an f, no out/inout parameters, no swizzles.
+
+// Bisection rounds per crossing (the step is cut to 1/4096 of its length)
+const int diskCrossingIterations = 12;
+
+// Point on the cubic Hermite curve through one step: it starts at p0 with velocity v0 and ends at p1
+// with velocity v1, h = step length (lambda), s = 0..1 along the step
+vec3 hermitePoint(vec3 p0, vec3 v0, vec3 p1, vec3 v1, float h, float s) {
+    float s2 = s * s;
+    float s3 = s2 * s;
+    return (2.0f * s3 - 3.0f * s2 + 1.0f) * p0 + ((s3 - 2.0f * s2 + s) * h) * v0
+         + (3.0f * s2 - 2.0f * s3) * p1 + ((s3 - s2) * h) * v1;
+}
+
+// Checks if the step from (p0, v0) to (p1, v1) crossed the disk plane (Y = 0) between innerRadius and
+// outerRadius of center. The crossing is found by bisection on the Hermite curve instead of the
+// straight chord, so long steps still land on the disk where the bent path really meets it.
+// Returns the distance from center at the crossing, or -1 if the step didn't hit the disk.
+float diskCrossingDistance(vec3 p0, vec3 v0, vec3 p1, vec3 v1, float h, vec3 center,
+                           float innerRadius, float outerRadius) {
+    // both ends on the same side: no crossing
+    bool startAbove = p0.y > 0.0f;
+    if (startAbove == (p1.y > 0.0f)) {
+        return -1.0f;
+    }
+
+    float low = 0.0f;
+    float high = 1.0f;
+    for (int i = 0; i < diskCrossingIterations; i++) {
+        float mid = 0.5f * (low + high);
+        if ((hermitePoint(p0, v0, p1, v1, h, mid).y > 0.0f) == startAbove) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+
+    vec3 hitPoint = hermitePoint(p0, v0, p1, v1, h, 0.5f * (low + high));
+    float distFromCenter = length(vec2(hitPoint.x - center.x, hitPoint.z - center.z));
+    if (distFromCenter >= innerRadius && distFromCenter <= outerRadius) {
+        return distFromCenter;
+    }
+    return -1.0f;
+}
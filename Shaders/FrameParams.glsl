@@ -0,0 +1,28 @@
+// Per-frame parameters shared by every shader (written once a frame by the CPU).
+// Pulled into a shader with #include "FrameParams.glsl" (expanded by Shader::LoadShaderFromFile).
+// Must stay in sync with struct FrameParams in Headers/FrameParams.hpp (std140 layout).
+
+layout(std140, binding = 0) uniform FrameParams {
+    mat4 u_cameraView;         // camera view matrix
+    mat4 u_cameraProjection;   // camera projection matrix
+    vec3 u_cameraPos;          // 3D camera position
+    float u_cameraFOV;         // Field of view in degrees
+
+    //black hole params
+    vec2 u_blackHolePos;
+    //screen params
+    vec2 u_screenSize;
+    float u_mass;
+    float u_Rs;
+
+    //integrator params
+    float u_tolerance;         // allowed local error per step for the adaptive integrator
+    int u_integrator;          // 0 = fixed step RK4, 1 = adaptive Dormand-Prince 5(4)
+
+    //render mode params
+    int u_renderMode;          // 0 = integrate every pixel, 1 = look paths up in the deflection table
+
+    //progressive refinement params
+    int u_sampleIndex;         // samples already accumulated for this view (0 = view changed, start over)
+    vec2 u_jitter;             // sub-pixel offset of this sample (0..1)
+};
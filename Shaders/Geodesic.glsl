@@ -0,0 +1,83 @@
+// Polar ray state and the RK4 step of the geodesic equations.
+// Shared by Shaders/geodesic.comp, Shaders/photons.comp and Shaders/caustics.comp (#include "Geodesic.glsl"),
+// they all define C and include FrameParams.glsl (for u_Rs) before including this.
+
+//ray state
+struct RayState{
+    float r;              // Distance from black hole
+    float theta;          // Angle (radians)
+    float dr_dlambda;     // Radial velocity
+    float dtheta_dlambda; // Angular velocity
+};
+
+// Add two ray states
+RayState addStates(RayState a, RayState b) {
+    RayState result;
+    result.r = a.r + b.r;
+    result.theta = a.theta + b.theta;
+    result.dr_dlambda = a.dr_dlambda + b.dr_dlambda;
+    result.dtheta_dlambda = a.dtheta_dlambda + b.dtheta_dlambda;
+    return result;
+}
+
+// Multiply ray state by scalar
+RayState multiplyState(RayState state, float scalar) {
+    RayState result;
+    result.r = state.r * scalar;
+    result.theta = state.theta * scalar;
+    result.dr_dlambda = state.dr_dlambda * scalar;
+    result.dtheta_dlambda = state.dtheta_dlambda * scalar;
+    return result;
+}
+
+// Calculate derivatives (geodesic equations)
+// Returns a RayState with derivatives: (dr/dlambda, dtheta/dlambda, d2r/dlambda2, d2theta/dlambda2)
+RayState calculateDerivatives(RayState state) {
+    // Extract current state
+    float r = state.r;
+    float dr = state.dr_dlambda;
+    float dtheta = state.dtheta_dlambda;
+
+    // Calculate accelerations using geodesic equations
+
+    // Angular acceleration: d2theta/dlambda2 = -(2/r) * (dr/dlambda) * (dtheta/dlambda)
+    float d2theta_dlambda2 = -(2.0 / r) * dr * dtheta;
+
+    // Radial acceleration: d2r/dlambda2 = -(c^2 * Rs)/(2*r^2) + r*(dtheta/dlambda)^2
+    float d2r_dlambda2 = -(C * C * u_Rs) / (2.0 * r * r) + r * dtheta * dtheta;
+
+    // Return derivatives (velocities and accelerations)
+    RayState derivatives;
+    derivatives.r = dr;                      // dr/dlambda
+    derivatives.theta = dtheta;              // dtheta/dlambda
+    derivatives.dr_dlambda = d2r_dlambda2;   // d2r/dlambda2
+    derivatives.dtheta_dlambda = d2theta_dlambda2;  // d2theta/dlambda2
+    return derivatives;
+}
+
+// Perform one RK4 integration step
+// Takes current state and time step, returns new state
+RayState rk4Step(RayState initial, float deltaTime) {
+    // k1: Evaluate at current position
+    RayState k1 = calculateDerivatives(initial);
+
+    // k2: Evaluate at midpoint using k1
+    RayState state2 = addStates(initial, multiplyState(k1, deltaTime / 2.0));
+    RayState k2 = calculateDerivatives(state2);
+
+    // k3: Evaluate at midpoint using k2
+    RayState state3 = addStates(initial, multiplyState(k2, deltaTime / 2.0));
+    RayState k3 = calculateDerivatives(state3);
+
+    // k4: Evaluate at endpoint using k3
+    RayState state4 = addStates(initial, multiplyState(k3, deltaTime));
+    RayState k4 = calculateDerivatives(state4);
+
+    // Combine with RK4 weights: initial + (k1 + 2*k2 + 2*k3 + k4) * dt/6
+    RayState k2_weighted = multiplyState(k2, 2.0);
+    RayState k3_weighted = multiplyState(k3, 2.0);
+    RayState sum = addStates(k1, addStates(k2_weighted, addStates(k3_weighted, k4)));
+    RayState increment = multiplyState(sum, deltaTime / 6.0);
+
+    return addStates(initial, increment);
+}
@@ -0,0 +1,28 @@
+// Storage buffers of the GPU photon stream (see Headers/PhotonSystem.hpp).
+// Shared by photons.comp, which steps the photons, and photons.vert, which draws their trails
+// straight out of the same buffers. Must stay in sync with struct GpuPhoton in src/PhotonSystem.cpp.
+
+struct Photon {
+    vec4 state;     // r, theta, dr/dlambda, dtheta/dlambda (polar around u_blackHolePos)
+    uint head;      // trail slot the next point goes in
+    uint count;     // trail points kept (0 = nothing to draw yet)
+    uint wait;      // steps left before the photon leaves the source
+    uint pad;
+};
+
+layout(std430, binding = 4) buffer Photons {
+    Photon photons[];
+};
+
+// Where a photon starts again after it fell in or left the scene (read only)
+layout(std430, binding = 5) readonly buffer PhotonSpawns {
+    vec4 spawns[];
+};
+
+// u_trailCapacity points per photon, photon i owns [i * u_trailCapacity, (i + 1) * u_trailCapacity)
+layout(std430, binding = 6) buffer PhotonTrails {
+    vec2 trailPoints[];
+};
+
+uniform uint u_photonCount;
+uniform uint u_trailCapacity;
@@ -0,0 +1,35 @@
+#version 450 core
+
+#include "CausticBuffers.glsl"
+
+uniform vec2 u_viewportSize;
+uniform mat4 u_inverseProjection;  // viewport (NDC) back to scene coordinates, see CausticRenderer::draw
+uniform float u_referenceCount;   // hits per cell if nothing bent the beam (causticReferenceCount)
+uniform float u_opacity;
+
+out vec4 FragColor;
+
+// Same as causticDensity in src/CausticMap.cpp: log2(count / reference) from -2 (0) to +2 (1)
+float causticDensity(uint count) {
+    if (count == 0u || u_referenceCount <= 0.0) {
+        return 0.0;
+    }
+    return clamp((log2(float(count) / u_referenceCount) + 2.0) / 4.0, 0.0, 1.0);
+}
+
+// Same ramp as causticColor in src/CausticMap.cpp: black, red, yellow, white
+vec3 causticColor(float density) {
+    float v = clamp(density, 0.0, 1.0) * 3.0;
+    return clamp(vec3(v, v - 1.0, v - 2.0), 0.0, 1.0);
+}
+
+void main() {
+    vec2 ndc = gl_FragCoord.xy / u_viewportSize * 2.0 - 1.0;
+    vec2 scenePos = (u_inverseProjection * vec4(ndc, 0.0, 1.0)).xy;
+    ivec2 cell = ivec2(floor(scenePos / u_sceneSize * vec2(u_gridSize)));
+    if (any(lessThan(cell, ivec2(0))) || any(greaterThanEqual(cell, u_gridSize))) {
+        discard;  // outside the scene (the window is wider or narrower than it)
+    }
+    float density = causticDensity(bins[cell.y * u_gridSize.x + cell.x]);
+    FragColor = vec4(causticColor(density), u_opacity * density);
+}
@@ -7,8 +7,8 @@ in float distFromBlackHole;
 // Output color
 out vec4 FragColor;
 
-// Uniforms
-uniform float u_Rs;
+// Uniforms (u_Rs)
+#include "FrameParams.glsl"
 
 void main() {
     // Base grid color: semi-transparent white/cyan
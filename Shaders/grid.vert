@@ -3,12 +3,11 @@
 // Input: vertex position from mesh
 layout(location = 0) in vec3 aPos;
 
+// Camera matrices, black hole position (u_blackHolePos) and Schwarzschild radius (u_Rs)
+#include "FrameParams.glsl"
+
 // Uniforms
 uniform mat4 u_Model;
-uniform mat4 u_View;
-uniform mat4 u_Projection;
-uniform vec2 u_blackHolePos;  // Black hole position in XY
-uniform float u_Rs;            // Schwarzschild radius
 uniform float u_warpStrength;  // How much to warp the grid
 
 // Output to fragment shader
@@ -39,5 +38,5 @@ void main() {
     worldPos = worldPosition.xyz;
 
     // Transform to clip space
-    gl_Position = u_Projection * u_View * worldPosition;
+    gl_Position = u_cameraProjection * u_cameraView * worldPosition;
 }
@@ -0,0 +1,11 @@
+#version 450 core
+in float v_fade;
+out vec4 FragColor;
+
+uniform vec4 u_Color;
+
+void main()
+{
+    // trails fade out towards their tail (blended additively, see PhotonSystem::draw)
+    FragColor = vec4(u_Color.rgb, u_Color.a * v_fade);
+}
@@ -0,0 +1,32 @@
+#version 450 core
+
+// Draws the photon trails as GL_LINES without any vertex buffer: vertex v is one end of segment v / 2,
+// which is read straight out of the trail ring photons.comp writes. Segments a photon doesn't
+// have yet are moved outside the clip volume so they are dropped before rasterization.
+
+#include "PhotonBuffers.glsl"
+
+uniform mat4 u_Projection;
+
+out float v_fade;   // 1 at the photon, 0 at the far end of a full trail
+
+void main()
+{
+    uint segmentsPerPhoton = u_trailCapacity - 1u;
+    uint segment = uint(gl_VertexID) / 2u;
+    uint photon = segment / segmentsPerPhoton;
+    uint pointIndex = segment % segmentsPerPhoton + uint(gl_VertexID) % 2u;   // 0 = oldest point kept
+
+    Photon p = photons[photon];
+    if (segment % segmentsPerPhoton + 1u >= p.count) {
+        v_fade = 0.0;
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    uint oldest = (p.head + u_trailCapacity - p.count) % u_trailCapacity;
+    vec2 point = trailPoints[photon * u_trailCapacity + (oldest + pointIndex) % u_trailCapacity];
+
+    v_fade = float(pointIndex + 1u) / float(p.count);
+    gl_Position = u_Projection * vec4(point, 0.0, 1.0);
+}
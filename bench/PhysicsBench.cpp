@@ -0,0 +1,856 @@
+#include <BlackHole.hpp>
+#include <Integrators.hpp>
+#include <RayBatch.hpp>
+#include <ThreadPool.hpp>
+#include <TrailArena.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+//microbenchmarks for the 2D light ray physics (LightRay, RayBatch and the helpers they use).
+//every scenario is fixed and seeded, so two runs on the same machine do exactly the same work.
+//results can be written as JSON and compared against an older run to catch slowdowns:
+//
+//  PhysicsBench --output baseline.json
+//  ...change something...
+//  PhysicsBench --baseline baseline.json      (exit code 1 if anything got slower than --threshold)
+
+// ===== Allocation counting =====
+//every allocation in the program goes through these, so the benchmarks can tell
+//how many allocations a step costs (should be 0 for all of them)
+static std::atomic<unsigned long long> allocationCount{ 0 };
+
+static void* alignedAllocate(size_t size, size_t alignment)
+{
+    size = (size + alignment - 1) / alignment * alignment;  // aligned_alloc wants a multiple of the alignment
+#ifdef _MSC_VER
+    return _aligned_malloc(size, alignment);
+#else
+    return std::aligned_alloc(alignment, size);
+#endif
+}
+
+static void alignedFree(void* pointer)
+{
+#ifdef _MSC_VER
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = alignedAllocate(size ? size : 1, static_cast<size_t>(alignment)))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { alignedFree(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { alignedFree(pointer); }
+
+// ===== Scene =====
+//same black hole as the app: at (400, 300) with Rs = 40 pixels
+static const glm::vec2 holePosition(400.0f, 300.0f);
+static const double holeRs = 40.0;
+static const float deltaTime = 0.016f;        // one frame at 60 fps, like main.cpp
+static const unsigned int seed = 20240611u;   // every random input comes from this
+
+//stops the compiler from throwing away results nobody reads
+static volatile float sink = 0.0f;
+
+struct BenchOptions
+{
+    int repetitions = 5;          // --reps (the median is reported)
+    double scale = 1.0;           // --quick makes every scenario 10x shorter
+    size_t fanRays = 1000000;     // --rays
+    std::string outputPath;       // --output
+    std::string baselinePath;     // --baseline
+    double threshold = 10.0;      // --threshold (percent slower that counts as a regression)
+    std::string filter;           // --filter (only run scenarios whose name contains this)
+    bool validate = false;        // --validate (conservation check of the integrators instead of timings)
+    bool scaling = false;         // --scaling (the fan on 1 .. all threads instead of the scenarios)
+    unsigned maxThreads = 0;      // --max-threads (highest thread count for --scaling, 0 = all cores)
+};
+
+struct BenchResult
+{
+    std::string name;
+    unsigned long long steps;     // per repetition
+    double nsPerStep;
+    double stepsPerSecond;
+    double allocsPerStep;
+};
+
+//runs setup (untimed) then body (timed) repetitions times and keeps the median.
+//body has to do exactly `steps` steps.
+static BenchResult runBenchmark(const BenchOptions& options, const std::string& name, unsigned long long steps,
+    const std::function<void()>& setup, const std::function<void()>& body)
+{
+    std::vector<double> times;
+    unsigned long long allocations = 0;
+    for (int rep = 0; rep < options.repetitions; ++rep)
+    {
+        setup();
+
+        unsigned long long allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        allocations += allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+        times.push_back(std::chrono::duration<double>(end - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    double seconds = times[times.size() / 2];
+
+    BenchResult result;
+    result.name = name;
+    result.steps = steps;
+    result.nsPerStep = seconds * 1.0e9 / static_cast<double>(steps);
+    result.stepsPerSecond = seconds > 0.0 ? static_cast<double>(steps) / seconds : 0.0;
+    result.allocsPerStep = static_cast<double>(allocations) / (static_cast<double>(steps) * options.repetitions);
+    return result;
+}
+
+static unsigned long long scaled(const BenchOptions& options, unsigned long long steps)
+{
+    return std::max<unsigned long long>(1, static_cast<unsigned long long>(steps * options.scale));
+}
+
+// ===== Single ray scenarios =====
+//one ray stepped with LightRay::step, started again whenever it falls in or leaves the scene
+struct SingleRayScenario
+{
+    const char* name;
+    glm::vec2 startOffset;   // from the hole, in units of Rs
+    glm::vec2 direction;
+    float escapeRadius;      // in units of Rs, restart once the ray gets further than this
+};
+
+static BenchResult runSingleRay(const BenchOptions& options, const SingleRayScenario& scenario, bool withTrail)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    float Rs = static_cast<float>(blackHole.schwarzschildRadius);
+    glm::vec2 start = holePosition + scenario.startOffset * Rs;
+    glm::vec2 velocity = glm::normalize(scenario.direction) * static_cast<float>(C);
+    float escapeRadius = scenario.escapeRadius * Rs;
+
+    TrailArena trails(withTrail ? 1 : 0, TrailSettings());
+    LightRay ray;
+    if (withTrail)
+    {
+        ray.trail = TrailHandle{ &trails, 0 };
+    }
+
+    unsigned long long steps = scaled(options, 2000000);
+    std::string name = scenario.name;
+    if (withTrail)
+    {
+        name += "_trail";
+    }
+
+    return runBenchmark(options, name, steps,
+        [&]() { ray.initialize(start, velocity, blackHole); },
+        [&]()
+        {
+            for (unsigned long long i = 0; i < steps; ++i)
+            {
+                ray.step(deltaTime, blackHole);
+                if (!ray.active || ray.r > escapeRadius)
+                {
+                    ray.initialize(start, velocity, blackHole);
+                }
+            }
+            sink = sink + ray.r;
+        });
+}
+
+// ===== Fan of rays (RayBatch) =====
+//like the --trails fan in the app: one source, rays spread over +-30 degrees,
+//with a little seeded jitter so neighbouring lanes don't follow identical paths
+static BenchResult runFan(const BenchOptions& options, SimdLevel level)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    glm::vec2 source(100.0f, 300.0f);
+    const float spreadAngle = glm::radians(60.0f);
+
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+
+    RayBatch pristine(options.fanRays);
+    for (size_t i = 0; i < options.fanRays; ++i)
+    {
+        float t = options.fanRays > 1 ? static_cast<float>(i) / static_cast<float>(options.fanRays - 1) : 0.5f;
+        float angle = -spreadAngle / 2.0f + spreadAngle * t;
+        glm::vec2 velocity(static_cast<float>(C) * std::cos(angle), static_cast<float>(C) * std::sin(angle));
+        pristine.addRay(source + glm::vec2(jitter(random), jitter(random)), velocity, blackHole);
+    }
+
+    int frames = static_cast<int>(std::max(1.0, 16.0 * options.scale));
+    unsigned long long steps = static_cast<unsigned long long>(options.fanRays) * frames;
+    RayBatch batch;
+    std::string name = std::string("fan_") + simdLevelName(level);
+
+    return runBenchmark(options, name, steps,
+        [&]() { batch = pristine; },
+        [&]()
+        {
+            for (int frame = 0; frame < frames; ++frame)
+            {
+                batch.step(deltaTime, blackHole, level);
+            }
+            sink = sink + batch.getState(0).r;
+        });
+}
+
+// ===== Integrator policies =====
+//the photon sphere graze through RayIntegrator, once per policy and scalar type.
+//one step = one frame (advance by deltaTime), so the adaptive policy's sub-steps are inside it.
+template <typename T>
+static BasicRayState<T> grazeStartState(const BlackHole& blackHole, const SingleRayScenario& scenario)
+{
+    float Rs = static_cast<float>(blackHole.schwarzschildRadius);
+    LightRay ray;
+    ray.initialize(holePosition + scenario.startOffset * Rs, glm::normalize(scenario.direction) * static_cast<float>(C),
+        blackHole);
+    RayState state = getRayState(ray);
+    return BasicRayState<T>{ static_cast<T>(state.r), static_cast<T>(state.theta),
+        static_cast<T>(state.dr_dlambda), static_cast<T>(state.dtheta_dlambda) };
+}
+
+template <typename T>
+static const char* scalarName()
+{
+    return sizeof(T) == sizeof(float) ? "float" : "double";
+}
+
+template <typename T, template <typename> class Policy>
+static BenchResult runIntegrator(const BenchOptions& options, const SingleRayScenario& scenario, const char* policyName)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    const T Rs = static_cast<T>(blackHole.schwarzschildRadius);
+    const T escapeRadius = static_cast<T>(scenario.escapeRadius) * Rs;
+    const BasicRayState<T> start = grazeStartState<T>(blackHole, scenario);
+
+    RayIntegrator<T, Policy> integrator(Rs);
+    BasicRayState<T> state = start;
+    unsigned long long steps = scaled(options, 500000);
+    std::string name = std::string("integrator_") + policyName + "_" + scalarName<T>();
+
+    return runBenchmark(options, name, steps,
+        [&]() { integrator = RayIntegrator<T, Policy>(Rs); state = start; },
+        [&]()
+        {
+            for (unsigned long long i = 0; i < steps; ++i)
+            {
+                integrator.advance(state, static_cast<T>(deltaTime));
+                if (state.r <= Rs || state.r > escapeRadius)
+                {
+                    integrator = RayIntegrator<T, Policy>(Rs);
+                    state = start;
+                }
+            }
+            sink = sink + static_cast<float>(state.r);
+        });
+}
+
+//along a geodesic of these equations L = r^2 * dtheta/dlambda and
+//E = (dr/dlambda)^2 / 2 - c^2 Rs / (2r) + L^2 / (2r^2) stay constant, so how far they wander
+//is a direct measure of the integration error. always evaluated in double.
+template <typename T, template <typename> class Policy>
+static void validateIntegrator(const SingleRayScenario& scenario, const char* policyName)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    const double Rs = blackHole.schwarzschildRadius;
+    const double escapeRadius = scenario.escapeRadius * Rs;
+
+    auto angularMomentum = [](const BasicRayState<T>& state)
+    {
+        return static_cast<double>(state.r) * state.r * state.dtheta_dlambda;
+    };
+    auto energy = [&](const BasicRayState<T>& state)
+    {
+        double r = state.r;
+        double L = angularMomentum(state);
+        return 0.5 * state.dr_dlambda * state.dr_dlambda - C * C * Rs / (2.0 * r) + L * L / (2.0 * r * r);
+    };
+
+    RayIntegrator<T, Policy> integrator(static_cast<T>(Rs));
+    BasicRayState<T> state = grazeStartState<T>(blackHole, scenario);
+    const double startL = angularMomentum(state);
+    const double startE = energy(state);
+    double minRadius = state.r;
+    double driftL = 0.0;
+    double driftE = 0.0;
+
+    //until the ray escapes or falls in (or a minute of simulated time)
+    int frames = 0;
+    for (; frames < 3750 && state.r > Rs && state.r <= escapeRadius; ++frames)
+    {
+        integrator.advance(state, static_cast<T>(deltaTime));
+        minRadius = std::min(minRadius, static_cast<double>(state.r));
+        driftL = std::max(driftL, std::abs(angularMomentum(state) - startL) / std::abs(startL));
+        driftE = std::max(driftE, std::abs(energy(state) - startE) / std::abs(startE));
+    }
+
+    std::string name = std::string(policyName) + "_" + scalarName<T>();
+    const char* outcome = state.r <= Rs ? "fell in" : (state.r > escapeRadius ? "escaped" : "running");
+    std::printf("%-24s %8d %12llu %12llu %10.4f %12.3e %12.3e  %s\n", name.c_str(), frames,
+        integrator.getStats().acceptedSteps, integrator.getStats().derivativeEvaluations, minRadius / Rs,
+        driftL, driftE, outcome);
+}
+
+static void runValidation(const SingleRayScenario& scenario)
+{
+    std::cout << "Conservation check on " << scenario.name << " (max relative drift of L and E):\n";
+    std::printf("%-24s %8s %12s %12s %10s %12s %12s\n", "integrator", "frames", "steps", "evaluations", "min r/Rs",
+        "drift L", "drift E");
+    validateIntegrator<float, Euler>(scenario, "euler");
+    validateIntegrator<double, Euler>(scenario, "euler");
+    validateIntegrator<float, VelocityVerlet>(scenario, "verlet");
+    validateIntegrator<double, VelocityVerlet>(scenario, "verlet");
+    validateIntegrator<float, RK4>(scenario, "rk4");
+    validateIntegrator<double, RK4>(scenario, "rk4");
+    validateIntegrator<float, AdaptiveDormandPrince>(scenario, "dopri5");
+    validateIntegrator<double, AdaptiveDormandPrince>(scenario, "dopri5");
+}
+
+// ===== Thread scaling =====
+//a fan aimed at the hole from 3 Rs away, spread over +-90 degrees: the middle falls in within a few
+//dozen frames, rays near the capture edge circle for a while first and the outer ones fly on, so the
+//work per chunk of rays ends up very uneven (like the big fans in the app)
+static RayBatch makeUnevenFan(size_t rayCount, const BlackHole& blackHole)
+{
+    float Rs = static_cast<float>(blackHole.schwarzschildRadius);
+    glm::vec2 source = holePosition - glm::vec2(3.0f * Rs, 0.0f);
+    const float spreadAngle = glm::radians(180.0f);
+
+    RayBatch batch(rayCount);
+    for (size_t i = 0; i < rayCount; ++i)
+    {
+        float t = rayCount > 1 ? static_cast<float>(i) / static_cast<float>(rayCount - 1) : 0.5f;
+        float angle = -spreadAngle / 2.0f + spreadAngle * t;
+        glm::vec2 velocity(static_cast<float>(C) * std::cos(angle), static_cast<float>(C) * std::sin(angle));
+        batch.addRay(source, velocity, blackHole);
+    }
+    return batch;
+}
+
+//steps the uneven fan on 1, 2, 4 ... threads, once with work stealing (RayBatch::defaultChunkRays chunks)
+//and once split statically (one chunk per thread, so there is nothing to steal). speedups are against 1 thread.
+static void runScaling(const BenchOptions& options)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    RayBatch pristine = makeUnevenFan(options.fanRays, blackHole);
+    int frames = static_cast<int>(std::max(1.0, 160.0 * options.scale));
+    unsigned long long steps = static_cast<unsigned long long>(options.fanRays) * frames;
+
+    unsigned maxThreads = options.maxThreads;
+    if (maxThreads == 0)
+    {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    //the threaded runs have to end exactly where the single threaded one does
+    RayBatch reference = pristine;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        reference.step(deltaTime, blackHole);
+    }
+
+    std::cout << "Fan of " << options.fanRays << " rays, " << frames << " frames, "
+              << reference.countActive() << " still active at the end\n";
+    std::printf("%8s %14s %9s %14s %9s %10s %8s\n", "threads", "stealing ms", "speedup", "static ms", "speedup",
+        "steals", "match");
+
+    RayBatch batch;
+    double stealingBase = 0.0;
+    double staticBase = 0.0;
+    for (unsigned threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        size_t staticChunk = (options.fanRays + threads - 1) / threads;
+
+        auto run = [&](size_t chunk)
+        {
+            return runBenchmark(options, "fan_scaling", steps,
+                [&]() { batch = pristine; },
+                [&]()
+                {
+                    for (int frame = 0; frame < frames; ++frame)
+                    {
+                        batch.step(deltaTime, blackHole, pool, chunk);
+                    }
+                });
+        };
+
+        unsigned long long stealsBefore = pool.getStealCount();
+        double stealingMs = run(RayBatch::defaultChunkRays).nsPerStep * static_cast<double>(steps) * 1.0e-6;
+        unsigned long long steals = (pool.getStealCount() - stealsBefore) / options.repetitions;
+        bool match = batch.countActive() == reference.countActive()
+            && batch.getState(batch.size() - 1).r == reference.getState(reference.size() - 1).r;
+        double staticMs = run(staticChunk).nsPerStep * static_cast<double>(steps) * 1.0e-6;
+
+        if (threads == 1)
+        {
+            stealingBase = stealingMs;
+            staticBase = staticMs;
+        }
+        std::printf("%8u %14.2f %8.2fx %14.2f %8.2fx %10llu %8s\n", threads, stealingMs, stealingBase / stealingMs,
+            staticMs, staticBase / staticMs, steals, match ? "yes" : "NO");
+    }
+    if (maxThreads > std::thread::hardware_concurrency())
+    {
+        std::cout << "(more threads than the " << std::thread::hardware_concurrency()
+                  << " hardware threads, the extra ones only share cores)\n";
+    }
+}
+
+// ===== Helper functions =====
+//each one is called on a table of seeded random inputs, one call counts as one step
+static const size_t inputCount = 4096;
+
+struct HelperInputs
+{
+    std::vector<glm::vec2> positions;
+    std::vector<glm::vec2> velocities;
+    std::vector<LightRay> rays;
+};
+
+static HelperInputs makeHelperInputs(const BlackHole& blackHole)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> coordinate(-800.0f, 800.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.28318530718f);  // 0..2 pi
+
+    HelperInputs inputs;
+    inputs.positions.reserve(inputCount);
+    inputs.velocities.reserve(inputCount);
+    inputs.rays.resize(inputCount);
+    for (size_t i = 0; i < inputCount; ++i)
+    {
+        glm::vec2 position = holePosition + glm::vec2(coordinate(random), coordinate(random));
+        float direction = angle(random);
+        glm::vec2 velocity(static_cast<float>(C) * std::cos(direction), static_cast<float>(C) * std::sin(direction));
+        inputs.positions.push_back(position);
+        inputs.velocities.push_back(velocity);
+        inputs.rays[i].initialize(position, velocity, blackHole);
+    }
+    return inputs;
+}
+
+static void runHelpers(const BenchOptions& options, std::vector<BenchResult>& results,
+    const std::function<bool(const std::string&)>& selected)
+{
+    BlackHole blackHole(holePosition, holeRs * C * C / (2.0 * G));
+    HelperInputs inputs = makeHelperInputs(blackHole);
+    unsigned long long passes = scaled(options, 1000);
+    unsigned long long steps = passes * inputCount;
+    auto nothing = []() {};
+
+    if (selected("cartesianToPolar"))
+    {
+        results.push_back(runBenchmark(options, "cartesianToPolar", steps, nothing, [&]()
+        {
+            float total = 0.0f;
+            for (unsigned long long pass = 0; pass < passes; ++pass)
+            {
+                for (const glm::vec2& position : inputs.positions)
+                {
+                    total += cartesianToPolar(position, holePosition).y;
+                }
+            }
+            sink = sink + total;
+        }));
+    }
+
+    if (selected("polarToCartesian"))
+    {
+        results.push_back(runBenchmark(options, "polarToCartesian", steps, nothing, [&]()
+        {
+            float total = 0.0f;
+            for (unsigned long long pass = 0; pass < passes; ++pass)
+            {
+                for (const LightRay& ray : inputs.rays)
+                {
+                    total += polarToCartesian(ray.r, ray.theta, holePosition).x;
+                }
+            }
+            sink = sink + total;
+        }));
+    }
+
+    if (selected("calculateAccelerations"))
+    {
+        results.push_back(runBenchmark(options, "calculateAccelerations", steps, nothing, [&]()
+        {
+            float total = 0.0f;
+            for (unsigned long long pass = 0; pass < passes; ++pass)
+            {
+                for (LightRay& ray : inputs.rays)
+                {
+                    calculateAccelerations(ray, blackHole);
+                    total += ray.d2r_dlambda2;
+                }
+            }
+            sink = sink + total;
+        }));
+    }
+
+    if (selected("LightRay::initialize"))
+    {
+        results.push_back(runBenchmark(options, "LightRay::initialize", steps, nothing, [&]()
+        {
+            float total = 0.0f;
+            for (unsigned long long pass = 0; pass < passes; ++pass)
+            {
+                for (size_t i = 0; i < inputCount; ++i)
+                {
+                    inputs.rays[i].initialize(inputs.positions[i], inputs.velocities[i], blackHole);
+                    total += inputs.rays[i].dtheta_dlambda;
+                }
+            }
+            sink = sink + total;
+        }));
+    }
+}
+
+// ===== Output =====
+static void printResults(const std::vector<BenchResult>& results)
+{
+    std::printf("%-28s %14s %12s %16s %12s\n", "scenario", "steps", "ns/step", "steps/s", "allocs/step");
+    for (const BenchResult& result : results)
+    {
+        std::printf("%-28s %14llu %12.3f %16.0f %12.4f\n", result.name.c_str(), result.steps,
+            result.nsPerStep, result.stepsPerSecond, result.allocsPerStep);
+    }
+}
+
+//one benchmark per line, so readBaseline doesn't need a real JSON parser
+static bool writeResults(const std::string& filePath, const std::vector<BenchResult>& results)
+{
+    std::ofstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "ERROR: Could not open benchmark output: " << filePath << std::endl;
+        return false;
+    }
+
+    file << "{\n  \"simd\": \"" << simdLevelName(detectSimdLevel()) << "\",\n  \"seed\": " << seed
+         << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        file << "    {\"name\": \"" << result.name << "\", \"steps\": " << result.steps
+             << ", \"nsPerStep\": " << result.nsPerStep << ", \"stepsPerSecond\": " << result.stepsPerSecond
+             << ", \"allocsPerStep\": " << result.allocsPerStep << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+    return file.good();
+}
+
+//reads the name -> ns/step pairs back out of a file written by writeResults
+static bool readBaseline(const std::string& filePath, std::map<std::string, double>& baseline)
+{
+    std::ifstream file(filePath);
+    if (!file.is_open())
+    {
+        std::cerr << "ERROR: Could not open baseline: " << filePath << std::endl;
+        return false;
+    }
+
+    const std::string nameKey = "\"name\": \"";
+    const std::string timeKey = "\"nsPerStep\": ";
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t namePos = line.find(nameKey);
+        size_t timePos = line.find(timeKey);
+        if (namePos == std::string::npos || timePos == std::string::npos)
+        {
+            continue;
+        }
+        namePos += nameKey.size();
+        size_t nameEnd = line.find('"', namePos);
+        if (nameEnd == std::string::npos)
+        {
+            continue;
+        }
+        baseline[line.substr(namePos, nameEnd - namePos)] = std::strtod(line.c_str() + timePos + timeKey.size(), nullptr);
+    }
+
+    if (baseline.empty())
+    {
+        std::cerr << "ERROR: No benchmarks found in baseline: " << filePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Prints the change against the baseline, returns false if anything got slower than the threshold
+static bool compareWithBaseline(const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline,
+    double threshold)
+{
+    bool passed = true;
+    std::printf("\n%-28s %12s %12s %10s\n", "scenario", "baseline", "now", "change");
+    for (const BenchResult& result : results)
+    {
+        auto found = baseline.find(result.name);
+        if (found == baseline.end() || found->second <= 0.0)
+        {
+            std::printf("%-28s %12s %12.3f %10s\n", result.name.c_str(), "-", result.nsPerStep, "new");
+            continue;
+        }
+
+        double change = (result.nsPerStep / found->second - 1.0) * 100.0;
+        bool regressed = change > threshold;
+        std::printf("%-28s %12.3f %12.3f %+9.1f%%%s\n", result.name.c_str(), found->second, result.nsPerStep, change,
+            regressed ? "  REGRESSION" : "");
+        passed = passed && !regressed;
+    }
+    return passed;
+}
+
+// ===== Command line =====
+static void printUsage(const char* programName)
+{
+    std::cout << "Usage: " << programName << " [options]\n"
+              << "  --reps N           repetitions per scenario, the median is reported (default 5)\n"
+              << "  --quick            10x shorter scenarios (for a quick check, noisier)\n"
+              << "  --rays N           rays in the fan scenarios (default 1000000)\n"
+              << "  --filter TEXT      only run scenarios whose name contains TEXT\n"
+              << "  --output FILE      write the results as JSON\n"
+              << "  --baseline FILE    compare against results written earlier with --output\n"
+              << "  --threshold PCT    slowdown that counts as a regression (default 10)\n"
+              << "  --validate         check how well each integrator keeps L and E constant (no timings)\n"
+              << "  --scaling          step the fan on 1, 2, 4 ... threads, work stealing vs a static split\n"
+              << "  --max-threads N    most threads for --scaling (default: all cores)\n"
+              << "  --help, -h         show this message\n";
+}
+
+static bool parseArguments(int argc, char** argv, BenchOptions& options, bool& showHelp)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--quick")
+        {
+            options.scale = 0.1;
+        }
+        else if (arg == "--validate")
+        {
+            options.validate = true;
+        }
+        else if (arg == "--scaling")
+        {
+            options.scaling = true;
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            showHelp = true;
+        }
+        else if (!hasValue && (arg == "--reps" || arg == "--rays" || arg == "--filter" || arg == "--output"
+            || arg == "--baseline" || arg == "--threshold" || arg == "--max-threads"))
+        {
+            std::cerr << "ERROR: " << arg << " needs a value" << std::endl;
+            return false;
+        }
+        else if (arg == "--reps")
+        {
+            options.repetitions = std::atoi(argv[++i]);
+        }
+        else if (arg == "--rays")
+        {
+            options.fanRays = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--filter")
+        {
+            options.filter = argv[++i];
+        }
+        else if (arg == "--output")
+        {
+            options.outputPath = argv[++i];
+        }
+        else if (arg == "--baseline")
+        {
+            options.baselinePath = argv[++i];
+        }
+        else if (arg == "--threshold")
+        {
+            options.threshold = std::atof(argv[++i]);
+        }
+        else if (arg == "--max-threads")
+        {
+            options.maxThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else
+        {
+            std::cerr << "ERROR: Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (options.repetitions <= 0 || options.fanRays == 0)
+    {
+        std::cerr << "ERROR: --reps and --rays must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    bool showHelp = false;
+    if (!parseArguments(argc, argv, options, showHelp))
+    {
+        printUsage(argv[0]);
+        return -1;
+    }
+    if (showHelp)
+    {
+        printUsage(argv[0]);
+        return 0;
+    }
+
+    auto selected = [&](const std::string& name)
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+
+    // Impact parameter of the photon sphere: rays coming in with b = 3*sqrt(3)/2 * Rs orbit forever,
+    // the graze starts just outside it so the ray loops around a few times before escaping
+    const float criticalImpact = 1.5f * std::sqrt(3.0f);
+    const SingleRayScenario singleRays[] = {
+        { "radial_plunge",       glm::vec2(20.0f, 0.0f),                      glm::vec2(-1.0f, 0.0f), 25.0f },
+        { "photon_sphere_graze", glm::vec2(-20.0f, criticalImpact * 1.001f),  glm::vec2(1.0f, 0.0f),  25.0f },
+        { "weak_field_flyby",    glm::vec2(-60.0f, 50.0f),                    glm::vec2(1.0f, 0.0f),  80.0f },
+    };
+
+    if (options.validate)
+    {
+        runValidation(singleRays[1]);
+        return 0;
+    }
+    if (options.scaling)
+    {
+        runScaling(options);
+        return 0;
+    }
+
+    std::cout << "=== PHYSICS BENCHMARKS ===\n";
+    std::cout << "SIMD: " << simdLevelName(detectSimdLevel()) << ", seed " << seed << ", "
+              << options.repetitions << " repetitions (median)\n\n";
+
+    std::vector<BenchResult> results;
+    for (const SingleRayScenario& scenario : singleRays)
+    {
+        if (selected(scenario.name))
+        {
+            results.push_back(runSingleRay(options, scenario, false));
+        }
+    }
+    if (selected("radial_plunge_trail"))
+    {
+        results.push_back(runSingleRay(options, singleRays[0], true));
+    }
+
+    // The fan with the scalar kernel and with the best one this CPU has
+    std::vector<SimdLevel> fanLevels = { SimdLevel::Scalar };
+    if (detectSimdLevel() != SimdLevel::Scalar)
+    {
+        fanLevels.push_back(detectSimdLevel());
+    }
+    for (SimdLevel level : fanLevels)
+    {
+        if (selected(std::string("fan_") + simdLevelName(level)))
+        {
+            results.push_back(runFan(options, level));
+        }
+    }
+
+    // Every stepping policy in both precisions (same graze as above, through RayIntegrator)
+    auto addIntegrator = [&](const std::string& name, BenchResult (*run)(const BenchOptions&, const SingleRayScenario&, const char*),
+        const char* policyName)
+    {
+        if (selected(name))
+        {
+            results.push_back(run(options, singleRays[1], policyName));
+        }
+    };
+    addIntegrator("integrator_euler_float", runIntegrator<float, Euler>, "euler");
+    addIntegrator("integrator_euler_double", runIntegrator<double, Euler>, "euler");
+    addIntegrator("integrator_verlet_float", runIntegrator<float, VelocityVerlet>, "verlet");
+    addIntegrator("integrator_verlet_double", runIntegrator<double, VelocityVerlet>, "verlet");
+    addIntegrator("integrator_rk4_float", runIntegrator<float, RK4>, "rk4");
+    addIntegrator("integrator_rk4_double", runIntegrator<double, RK4>, "rk4");
+    addIntegrator("integrator_dopri5_float", runIntegrator<float, AdaptiveDormandPrince>, "dopri5");
+    addIntegrator("integrator_dopri5_double", runIntegrator<double, AdaptiveDormandPrince>, "dopri5");
+
+    runHelpers(options, results, selected);
+
+    printResults(results);
+
+    if (!options.outputPath.empty())
+    {
+        if (!writeResults(options.outputPath, results))
+        {
+            return -1;
+        }
+        std::cout << "Wrote " << options.outputPath << "\n";
+    }
+
+    if (!options.baselinePath.empty())
+    {
+        std::map<std::string, double> baseline;
+        if (!readBaseline(options.baselinePath, baseline))
+        {
+            return -1;
+        }
+        if (!compareWithBaseline(results, baseline, options.threshold))
+        {
+            std::cout << "\nSlower than the baseline by more than " << options.threshold << "%\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,38 @@
+# Turns every file in SHADER_DIR into a byte array in OUTPUT (a .cpp), so the executable
+# carries its own shader sources. Run at build time by the custom command in CmakeLists.txt:
+#   cmake -DSHADER_DIR=... -DOUTPUT=... -P EmbedShaders.cmake
+# Byte arrays instead of string literals because MSVC caps string literals at 16 KB.
+
+file(GLOB shaderFiles RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*)
+list(SORT shaderFiles)
+
+# one line of 16 bytes (CMake regexes have no {16})
+string(REPEAT "0x[0-9a-f][0-9a-f]," 16 lineOfBytes)
+
+set(arrays "")
+set(entries "")
+set(index 0)
+foreach(shaderFile ${shaderFiles})
+    file(READ ${SHADER_DIR}/${shaderFile} contents HEX)
+    string(LENGTH "${contents}" hexLength)
+    math(EXPR size "${hexLength} / 2")
+    # 0xAB, per byte, with a line break every 16 bytes
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${contents}")
+    string(REGEX REPLACE "(${lineOfBytes})" "\\1\n    " bytes "${bytes}")
+    string(APPEND arrays "// ${shaderFile}\nstatic const unsigned char shader${index}[] = {\n    ${bytes}0x00\n};\n\n")
+    string(APPEND entries "    { \"${shaderFile}\", reinterpret_cast<const char*>(shader${index}), ${size} },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+set(source "// Generated by cmake/EmbedShaders.cmake from the Shaders folder, do not edit.\n")
+string(APPEND source "#include <EmbeddedShaders.hpp>\n\n${arrays}")
+string(APPEND source "const EmbeddedShader embeddedShaders[] = {\n${entries}};\n\n")
+string(APPEND source "const size_t embeddedShaderCount = ${index};\n")
+
+# only touch the file when something changed, so the build doesn't recompile it every time
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif()
+if(NOT "${previous}" STREQUAL "${source}")
+    file(WRITE ${OUTPUT} "${source}")
+endif()
@@ -1,4 +1,5 @@
 #include <BlackHole.hpp>
+#include <algorithm>
 #include <cmath>
 BlackHole::BlackHole(glm::vec2 pos, double m)
 {
@@ -10,66 +11,55 @@ BlackHole::BlackHole(glm::vec2 pos, double m)
     schwarzschildRadius = (2 * G * mass) / (C * C);
 }
 
-//we would use RK4 to step the light ray forward in time.
-void LightRay::step(float deltaTime, const BlackHole& blackHole)
+//moves the ray with one of the integrators from Integrators.hpp, then updates what the window draws.
+//trying another scheme is just another RayIntegrator<float, Policy>, the stepping code lives in one place.
+template <template <typename> class Policy>
+static void advanceRay(LightRay& ray, RayIntegrator<float, Policy>& integrator, float deltaTime, const BlackHole& blackHole)
 {
-    // Save initial state
-    RayState initial = getRayState(*this);
-
-    // ===== k1: Evaluate at current position =====
-    calculateAccelerations(*this, blackHole);
-    RayState k1 = RayState{
-        dr_dlambda,           // derivative of r
-        dtheta_dlambda,       // derivative of theta
-        d2r_dlambda2,         // derivative of dr_dlambda
-        d2theta_dlambda2      // derivative of dtheta_dlambda
-    };
-
-    // ===== k2: Evaluate at midpoint using k1 =====
-    setRayState(*this, initial + k1 * (deltaTime / 2.0f));
-    calculateAccelerations(*this, blackHole);
-    RayState k2 = RayState{
-        dr_dlambda,
-        dtheta_dlambda,
-        d2r_dlambda2,
-        d2theta_dlambda2
-    };
-
-    // ===== k3: Evaluate at midpoint using k2 =====
-    setRayState(*this, initial + k2 * (deltaTime / 2.0f));
-    calculateAccelerations(*this, blackHole);
-    RayState k3 = RayState{
-        dr_dlambda,
-        dtheta_dlambda,
-        d2r_dlambda2,
-        d2theta_dlambda2
-    };
-
-    // ===== k4: Evaluate at endpoint using k3 =====
-    setRayState(*this, initial + k3 * deltaTime);
-    calculateAccelerations(*this, blackHole);
-    RayState k4 = RayState{
-        dr_dlambda,
-        dtheta_dlambda,
-        d2r_dlambda2,
-        d2theta_dlambda2
-    };
-
-    // ===== Combine with RK4 weights =====
-    RayState finalState = initial + (k1 + k2 * 2.0f + k3 * 2.0f + k4) * (deltaTime / 6.0f);
-    setRayState(*this, finalState);
+    //the stages are worked out on a copy of the state, the ray's own fields are only written once at the end
+    RayState state = getRayState(ray);
+    integrator.advance(state, deltaTime);
+    setRayState(ray, state);
 
     // Update Cartesian position for rendering
-    glm::vec2 cartesian = polarToCartesian(r, theta, blackHole.position);
-    position = cartesian;
+    ray.position = polarToCartesian(ray.r, ray.theta, blackHole.position);
 
     // Add to trail
-    trail.push_back(position);
+    ray.trail.push(ray.position);
+
+    // EVENT HORIZON CHECK
+    if (ray.r <= blackHole.schwarzschildRadius)
+    {
+        ray.active = false;  // Ray hit the event horizon - deactivate it
+    }
+}
+
+//we would use RK4 to step the light ray forward in time.
+//for large fans of rays use RayBatch instead, it steps many rays at once with SIMD.
+void LightRay::step(float deltaTime, const BlackHole& blackHole)
+{
+    RayIntegrator<float, RK4> integrator(static_cast<float>(blackHole.schwarzschildRadius));
+    advanceRay(*this, integrator, deltaTime, blackHole);
+}
 
-    // EVENT HORIZON CHECK (ADD THIS)
-    if (r <= blackHole.schwarzschildRadius)
+void LightRay::stepAdaptive(float deltaTime, const BlackHole& blackHole, const AdaptiveStepSettings& settings,
+    IntegratorStats* stats)
+{
+    // Sub-steps until the whole frame time is covered (or the ray falls in), starting from the
+    // step size this ray ended the last frame with
+    AdaptiveDormandPrince<float> policy;
+    policy.settings = settings;
+    policy.nextStep = adaptiveStepSize;
+    RayIntegrator<float, AdaptiveDormandPrince> integrator(static_cast<float>(blackHole.schwarzschildRadius), policy);
+    advanceRay(*this, integrator, deltaTime, blackHole);
+    adaptiveStepSize = integrator.getPolicy().nextStep;
+
+    if (stats)
     {
-        active = false;  // Ray hit the event horizon - deactivate it
+        const IntegratorStats& taken = integrator.getStats();
+        stats->acceptedSteps += taken.acceptedSteps;
+        stats->rejectedSteps += taken.rejectedSteps;
+        stats->derivativeEvaluations += taken.derivativeEvaluations;
     }
 }
 
@@ -104,6 +94,9 @@ void LightRay::initialize(glm::vec2 startPos, glm::vec2 startVel, const BlackHol
         dtheta_dlambda = 0.0f;
     }
 
+    // Let the adaptive integrator pick its own first step
+    adaptiveStepSize = 0.0f;
+
     // Initialize accelerations to zero (will be calculated in first step)
     d2r_dlambda2 = 0.0f;
     d2theta_dlambda2 = 0.0f;
@@ -113,7 +106,7 @@ void LightRay::initialize(glm::vec2 startPos, glm::vec2 startVel, const BlackHol
 
     // Clear trail and add starting position
     trail.clear();
-    trail.push_back(position);
+    trail.push(position);
 }
 
 glm::vec2 cartesianToPolar(glm::vec2 pos, glm::vec2 blackHole)
@@ -171,4 +164,20 @@ void setRayState(LightRay& ray, const RayState& state)
     ray.theta = state.theta;
     ray.dr_dlambda = state.dr_dlambda;
     ray.dtheta_dlambda = state.dtheta_dlambda;
-}
\ No newline at end of file
+}
+RayState calculateDerivatives(const RayState& state, float Rs)
+{
+    //the shader works in float, so this is the float instance.
+    return geodesicDerivatives(state, Rs);
+}
+
+RayState rk4Step(const RayState& initial, float deltaTime, float Rs)
+{
+    return RK4<float>::step(initial, deltaTime, Rs);
+}
+
+float dopri5Step(RayState& state, float& stepSize, float Rs, const AdaptiveStepSettings& settings,
+    IntegratorStats* stats, float stepCap)
+{
+    return dormandPrinceStep(state, stepSize, Rs, settings, stats, stepCap);
+}
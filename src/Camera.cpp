@@ -54,4 +54,17 @@ void Camera::processKeyboard(GLFWwindow* window, float deltaTime)
         radius += speed;
 
     radius = glm::clamp(radius, minRadius, maxRadius);
-}
\ No newline at end of file
+}
+
+bool Camera::consumeChanges()
+{
+    ViewState current{ target, radius, azimuth, elevation, fov };
+    if (hasLastView && current == lastView)
+    {
+        return false;
+    }
+
+    lastView = current;
+    hasLastView = true;
+    return true;
+}
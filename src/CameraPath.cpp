@@ -0,0 +1,147 @@
+#include <CameraPath.hpp>
+#include <glm/gtc/constants.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+//uniform Catmull-Rom between p1 and p2 (p0 and p3 are the neighbours), t in [0, 1]
+static float catmullRom(float p0, float p1, float p2, float p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return 0.5f * ((2.0f * p1) + (-p0 + p2) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+		+ (-p0 + 3.0f * p1 - 3.0f * p2 + p3) * t3);
+}
+
+void CameraPath::addKeyframe(const CameraKeyframe& keyframe)
+{
+	keyframes.push_back(keyframe);
+}
+
+bool CameraPath::loadFromFile(const std::string& filePath)
+{
+	std::ifstream file(filePath);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open camera path: " << filePath << std::endl;
+		return false;
+	}
+
+	keyframes.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		line = line.substr(0, line.find('#'));
+		if (line.find_first_not_of(" \t\r") == std::string::npos)
+		{
+			continue; //empty or comment only
+		}
+
+		std::istringstream values(line);
+		CameraKeyframe keyframe;
+		if (!(values >> keyframe.time >> keyframe.radius >> keyframe.azimuth >> keyframe.elevation >> keyframe.fov))
+		{
+			std::cerr << "ERROR: " << filePath << ":" << lineNumber
+			          << ": expected 'time radius azimuth elevation fov'" << std::endl;
+			return false;
+		}
+		if (!keyframes.empty() && keyframe.time <= keyframes.back().time)
+		{
+			std::cerr << "ERROR: " << filePath << ":" << lineNumber << ": keyframe times must increase" << std::endl;
+			return false;
+		}
+
+		//the file is in degrees, Camera works in radians (except fov)
+		keyframe.azimuth = glm::radians(keyframe.azimuth);
+		keyframe.elevation = glm::radians(keyframe.elevation);
+		keyframes.push_back(keyframe);
+	}
+
+	if (keyframes.empty())
+	{
+		std::cerr << "ERROR: No keyframes in camera path: " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+CameraPath CameraPath::orbit(const Camera& camera, float duration)
+{
+	//four quarter turns, so the spline stays on the circle instead of cutting across it
+	CameraPath path;
+	for (int i = 0; i <= 4; ++i)
+	{
+		float fraction = static_cast<float>(i) / 4.0f;
+		path.addKeyframe(CameraKeyframe{ duration * fraction, camera.radius,
+			camera.azimuth + 2.0f * glm::pi<float>() * fraction, camera.elevation, camera.fov });
+	}
+	return path;
+}
+
+bool CameraPath::empty() const
+{
+	return keyframes.empty();
+}
+
+float CameraPath::getDuration() const
+{
+	return keyframes.empty() ? 0.0f : keyframes.back().time;
+}
+
+const std::vector<CameraKeyframe>& CameraPath::getKeyframes() const
+{
+	return keyframes;
+}
+
+CameraKeyframe CameraPath::sample(float time) const
+{
+	if (keyframes.empty())
+	{
+		return CameraKeyframe{ time, 200.0f, 0.0f, 0.3f, 45.0f }; //Camera's defaults
+	}
+	if (time <= keyframes.front().time)
+	{
+		CameraKeyframe result = keyframes.front();
+		result.time = time;
+		return result;
+	}
+	if (time >= keyframes.back().time)
+	{
+		CameraKeyframe result = keyframes.back();
+		result.time = time;
+		return result;
+	}
+
+	//find the segment [i, i + 1] holding time
+	size_t i = 0;
+	while (keyframes[i + 1].time < time)
+	{
+		i++;
+	}
+
+	//the ends repeat the first/last keyframe as their missing neighbour
+	const CameraKeyframe& k0 = keyframes[i > 0 ? i - 1 : i];
+	const CameraKeyframe& k1 = keyframes[i];
+	const CameraKeyframe& k2 = keyframes[i + 1];
+	const CameraKeyframe& k3 = keyframes[i + 2 < keyframes.size() ? i + 2 : i + 1];
+	float t = (time - k1.time) / (k2.time - k1.time);
+
+	CameraKeyframe result;
+	result.time = time;
+	result.radius = catmullRom(k0.radius, k1.radius, k2.radius, k3.radius, t);
+	result.azimuth = catmullRom(k0.azimuth, k1.azimuth, k2.azimuth, k3.azimuth, t);
+	result.elevation = catmullRom(k0.elevation, k1.elevation, k2.elevation, k3.elevation, t);
+	result.fov = catmullRom(k0.fov, k1.fov, k2.fov, k3.fov, t);
+	return result;
+}
+
+void CameraPath::apply(Camera& camera, float time) const
+{
+	CameraKeyframe values = sample(time);
+	camera.radius = values.radius;
+	camera.azimuth = values.azimuth;
+	camera.elevation = values.elevation;
+	camera.fov = values.fov;
+}
@@ -0,0 +1,237 @@
+#include <CausticMap.hpp>
+#include <RayBatch.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// Cells per chunk when the thread grids are summed
+static const size_t reduceChunkCells = 16384;
+
+//integer hash (PCG output permutation), caustics.comp has the same one so both sides jitter the same way
+static uint32_t causticHash(uint32_t value)
+{
+	uint32_t state = value * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+glm::vec2 causticRayStart(uint32_t index, uint32_t rayCount, const CausticSettings& settings)
+{
+	uint32_t hashY = causticHash(index ^ settings.seed);
+	uint32_t hashX = causticHash(hashY);
+	float jitterY = static_cast<float>(hashY >> 8) * (1.0f / 16777216.0f);
+	float jitterX = static_cast<float>(hashX >> 8) * (1.0f / 16777216.0f);
+
+	float slice = settings.sceneSize.y / static_cast<float>(rayCount);
+	return glm::vec2(settings.emitterX - jitterX * settings.speed * settings.deltaTime,
+		static_cast<float>(index) * slice + jitterY * slice);
+}
+
+float causticReferenceCount(size_t rayCount, const CausticSettings& settings)
+{
+	float raysPerRow = static_cast<float>(rayCount) / static_cast<float>(settings.gridHeight);
+	float stepsPerCell = settings.sceneSize.x / static_cast<float>(settings.gridWidth) / (settings.speed * settings.deltaTime);
+	return raysPerRow * stepsPerCell;
+}
+
+float causticDensity(uint32_t count, float reference)
+{
+	if (count == 0 || reference <= 0.0f)
+	{
+		return 0.0f;
+	}
+	return std::clamp((std::log2(static_cast<float>(count) / reference) + 2.0f) / 4.0f, 0.0f, 1.0f);
+}
+
+glm::vec3 causticColor(float density)
+{
+	float v = std::clamp(density, 0.0f, 1.0f) * 3.0f;
+	return glm::vec3(std::clamp(v, 0.0f, 1.0f), std::clamp(v - 1.0f, 0.0f, 1.0f), std::clamp(v - 2.0f, 0.0f, 1.0f));
+}
+
+CausticMap::CausticMap(const CausticSettings& settings)
+	: settings(settings)
+{
+	counts.assign(static_cast<size_t>(settings.gridWidth) * settings.gridHeight, 0);
+}
+
+void CausticMap::build(size_t rays, const BlackHole& blackHole, ThreadPool& pool)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	rayCount = rays;
+	const unsigned threadCount = pool.getThreadCount();
+	const size_t cellCount = static_cast<size_t>(settings.gridWidth) * settings.gridHeight;
+	const float cellsPerUnitX = static_cast<float>(settings.gridWidth) / settings.sceneSize.x;
+	const float cellsPerUnitY = static_cast<float>(settings.gridHeight) / settings.sceneSize.y;
+	const SimdLevel level = detectSimdLevel();
+
+	//one private grid and one ray batch per thread, nothing is shared while the rays run
+	std::vector<std::vector<uint32_t>> grids(threadCount, std::vector<uint32_t>(cellCount, 0));
+	std::vector<RayBatch> batches(threadCount);
+	std::vector<unsigned long long> threadSteps(threadCount, 0);
+	for (RayBatch& batch : batches)
+	{
+		batch.reserve(chunkRays);
+	}
+
+	pool.parallelForRange(rayCount, chunkRays, [&](size_t begin, size_t end, unsigned thread)
+	{
+		RayBatch& batch = batches[thread];
+		batch.clear();
+		for (size_t i = begin; i < end; ++i)
+		{
+			glm::vec2 start = causticRayStart(static_cast<uint32_t>(i), static_cast<uint32_t>(rayCount), settings);
+			batch.addRay(start, glm::vec2(settings.speed, 0.0f), blackHole);
+		}
+
+		//the padding lanes are inactive, stepping them keeps the SIMD kernels on whole registers
+		size_t lanesUsed = (batch.size() + RayBatch::laneWidth - 1) / RayBatch::laneWidth * RayBatch::laneWidth;
+		RayBatchLanes lanes = batch.lanes();
+		uint32_t* grid = grids[thread].data();
+		unsigned long long steps = 0;
+
+		for (int step = 0; step < settings.maxSteps; ++step)
+		{
+			batch.stepRange(0, lanesUsed, settings.deltaTime, blackHole, level);
+
+			size_t alive = 0;
+			for (size_t k = 0; k < batch.size(); ++k)
+			{
+				if (!lanes.active[k])
+				{
+					continue;
+				}
+				++alive;
+
+				//gone for good: outside the scene and moving away from the hole
+				if (lanes.r[k] > settings.escapeRadius && lanes.dr_dlambda[k] > 0.0f)
+				{
+					lanes.active[k] = 0;
+					continue;
+				}
+
+				glm::vec2 position = polarToCartesian(lanes.r[k], lanes.theta[k], blackHole.position);
+				int cellX = static_cast<int>(std::floor(position.x * cellsPerUnitX));
+				int cellY = static_cast<int>(std::floor(position.y * cellsPerUnitY));
+				if (cellX >= 0 && cellX < settings.gridWidth && cellY >= 0 && cellY < settings.gridHeight)
+				{
+					++grid[static_cast<size_t>(cellY) * settings.gridWidth + cellX];
+				}
+			}
+			steps += alive;
+
+			if (alive == 0)
+			{
+				break;
+			}
+		}
+		threadSteps[thread] += steps;
+	});
+
+	//reduction: every thread sums a slice of cells over all the private grids
+	counts.assign(cellCount, 0);
+	std::vector<uint32_t> sliceMax(threadCount, 0);
+	pool.parallelForRange(cellCount, reduceChunkCells, [&](size_t begin, size_t end, unsigned thread)
+	{
+		for (const std::vector<uint32_t>& grid : grids)
+		{
+			for (size_t cell = begin; cell < end; ++cell)
+			{
+				counts[cell] += grid[cell];
+			}
+		}
+		for (size_t cell = begin; cell < end; ++cell)
+		{
+			sliceMax[thread] = std::max(sliceMax[thread], counts[cell]);
+		}
+	});
+
+	maxCount = *std::max_element(sliceMax.begin(), sliceMax.end());
+	stepCount = 0;
+	for (unsigned long long steps : threadSteps)
+	{
+		stepCount += steps;
+	}
+
+	buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const CausticSettings& CausticMap::getSettings() const
+{
+	return settings;
+}
+
+const std::vector<uint32_t>& CausticMap::getCounts() const
+{
+	return counts;
+}
+
+uint32_t CausticMap::getMaxCount() const
+{
+	return maxCount;
+}
+
+size_t CausticMap::getRayCount() const
+{
+	return rayCount;
+}
+
+unsigned long long CausticMap::getStepCount() const
+{
+	return stepCount;
+}
+
+double CausticMap::getBuildSeconds() const
+{
+	return buildSeconds;
+}
+
+std::vector<unsigned char> CausticMap::toRGBA() const
+{
+	std::vector<unsigned char> rgba(counts.size() * 4);
+	float reference = causticReferenceCount(rayCount, settings);
+	for (size_t cell = 0; cell < counts.size(); ++cell)
+	{
+		glm::vec3 color = causticColor(causticDensity(counts[cell], reference));
+		rgba[cell * 4 + 0] = static_cast<unsigned char>(color.x * 255.0f + 0.5f);
+		rgba[cell * 4 + 1] = static_cast<unsigned char>(color.y * 255.0f + 0.5f);
+		rgba[cell * 4 + 2] = static_cast<unsigned char>(color.z * 255.0f + 0.5f);
+		rgba[cell * 4 + 3] = 255;
+	}
+	return rgba;
+}
+
+bool CausticMap::writePPM(const std::string& filePath) const
+{
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open output image: " << filePath << std::endl;
+		return false;
+	}
+
+	const int width = settings.gridWidth;
+	const int height = settings.gridHeight;
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	//grid rows are bottom-up, image rows are top-down
+	std::vector<unsigned char> rgba = toRGBA();
+	std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+	for (int y = height - 1; y >= 0; --y)
+	{
+		const unsigned char* src = &rgba[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; ++x)
+		{
+			row[x * 3 + 0] = src[x * 4 + 0];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+
+	return file.good();
+}
@@ -0,0 +1,152 @@
+#include <CausticRenderer.hpp>
+#include <BlackHole.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+
+// storage buffer binding, must match Shaders/CausticBuffers.glsl
+static const GLuint binBinding = 7;
+
+// caustics.comp local_size_x
+static const GLuint causticGroupSize = 64;
+
+CausticRenderer::CausticRenderer(size_t rayCount, const CausticSettings& settings)
+	: rayCount(rayCount), settings(settings)
+{
+	glCreateBuffers(1, &binBuffer);
+	glNamedBufferStorage(binBuffer, memoryBytes(), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateVertexArrays(1, &emptyVAO);
+
+	reset();
+}
+
+CausticRenderer::~CausticRenderer()
+{
+	glDeleteBuffers(1, &binBuffer);
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void CausticRenderer::reset()
+{
+	GLuint zero = 0;
+	glClearNamedBufferData(binBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	raysDone = 0;
+}
+
+void CausticRenderer::setGridUniforms(Shader& shader) const
+{
+	glUniform2i(shader.GetUniformLocation("u_gridSize"), settings.gridWidth, settings.gridHeight);
+	shader.SetVec2("u_sceneSize", settings.sceneSize);
+}
+
+void CausticRenderer::accumulate(Shader& computeShader, size_t batchRays)
+{
+	if (isComplete())
+	{
+		return;
+	}
+	size_t batch = std::min(std::max<size_t>(batchRays, 1), rayCount - raysDone);
+
+	computeShader.Use();
+	setGridUniforms(computeShader);
+	glUniform1ui(computeShader.GetUniformLocation("u_firstRay"), static_cast<GLuint>(raysDone));
+	glUniform1ui(computeShader.GetUniformLocation("u_rayCount"), static_cast<GLuint>(rayCount));
+	glUniform1ui(computeShader.GetUniformLocation("u_seed"), settings.seed);
+	computeShader.SetFloat("u_emitterX", settings.emitterX);
+	computeShader.SetFloat("u_speed", settings.speed);
+	computeShader.SetFloat("u_deltaTime", settings.deltaTime);
+	computeShader.SetInt("u_maxSteps", settings.maxSteps);
+	computeShader.SetFloat("u_escapeRadius", settings.escapeRadius);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binBinding, binBuffer);
+
+	glDispatchCompute(static_cast<GLuint>((batch + causticGroupSize - 1) / causticGroupSize), 1, 1);
+	//the counts are read by caustics.frag
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	raysDone += batch;
+}
+
+void CausticRenderer::draw(Shader& drawShader, const glm::mat4& projection, glm::vec2 viewportSize, float opacity)
+{
+	drawShader.Use();
+	setGridUniforms(drawShader);
+	drawShader.SetVec2("u_viewportSize", viewportSize);
+	drawShader.SetMat4("u_inverseProjection", glm::inverse(projection));
+	//the batches fill the map from the bottom up, the rows done so far already have all their rays
+	drawShader.SetFloat("u_referenceCount", causticReferenceCount(rayCount, settings));
+	drawShader.SetFloat("u_opacity", opacity);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binBinding, binBuffer);
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+}
+
+std::vector<uint32_t> CausticRenderer::readCounts() const
+{
+	std::vector<uint32_t> counts(static_cast<size_t>(settings.gridWidth) * settings.gridHeight);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(binBuffer, 0, memoryBytes(), counts.data());
+	return counts;
+}
+
+CausticCheck CausticRenderer::checkAgainstCpu(Shader& computeShader, const BlackHole& blackHole, ThreadPool& pool,
+	uint32_t minCount, float tolerance)
+{
+	reset();
+	while (!isComplete())
+	{
+		accumulate(computeShader);
+	}
+	std::vector<uint32_t> gpuCounts = readCounts();
+	reset();
+
+	CausticMap cpuMap(settings);
+	cpuMap.build(rayCount, blackHole, pool);
+	const std::vector<uint32_t>& cpuCounts = cpuMap.getCounts();
+
+	//the two sides round differently (FMA, SIMD lanes), a ray grazing the photon sphere can end up
+	//somewhere else entirely, so single cells may be off but the totals and most cells have to agree
+	CausticCheck check;
+	for (size_t cell = 0; cell < cpuCounts.size(); ++cell)
+	{
+		check.cpuTotal += cpuCounts[cell];
+		check.gpuTotal += gpuCounts[cell];
+		if (cpuCounts[cell] < minCount)
+		{
+			continue;
+		}
+
+		float difference = std::abs(static_cast<float>(gpuCounts[cell]) - static_cast<float>(cpuCounts[cell]))
+			/ static_cast<float>(cpuCounts[cell]);
+		++check.cellsChecked;
+		if (difference <= tolerance)
+		{
+			++check.cellsAgreeing;
+		}
+		check.maxRelativeError = std::max(check.maxRelativeError, difference);
+	}
+	return check;
+}
+
+bool CausticRenderer::isComplete() const
+{
+	return raysDone >= rayCount;
+}
+
+size_t CausticRenderer::getRaysDone() const
+{
+	return raysDone;
+}
+
+size_t CausticRenderer::getRayCount() const
+{
+	return rayCount;
+}
+
+size_t CausticRenderer::memoryBytes() const
+{
+	return static_cast<size_t>(settings.gridWidth) * settings.gridHeight * sizeof(GLuint);
+}
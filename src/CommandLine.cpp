@@ -0,0 +1,281 @@
+#include <CommandLine.hpp>
+#include <iostream>
+#include <string_view>
+
+//reads the value after a flag as an int, prints an error if it's missing or not a number
+static bool readInt(int argc, char** argv, int& i, int& out)
+{
+	if (i + 1 >= argc)
+	{
+		std::cerr << "ERROR: " << argv[i] << " needs a value" << std::endl;
+		return false;
+	}
+
+	try
+	{
+		out = std::stoi(argv[++i]);
+	}
+	catch (...)
+	{
+		std::cerr << "ERROR: " << argv[i - 1] << " expects a number, got: " << argv[i] << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool readFloat(int argc, char** argv, int& i, float& out)
+{
+	if (i + 1 >= argc)
+	{
+		std::cerr << "ERROR: " << argv[i] << " needs a value" << std::endl;
+		return false;
+	}
+
+	try
+	{
+		out = std::stof(argv[++i]);
+	}
+	catch (...)
+	{
+		std::cerr << "ERROR: " << argv[i - 1] << " expects a number, got: " << argv[i] << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool readString(int argc, char** argv, int& i, std::string& out)
+{
+	if (i + 1 >= argc)
+	{
+		std::cerr << "ERROR: " << argv[i] << " needs a value" << std::endl;
+		return false;
+	}
+	out = argv[++i];
+	return true;
+}
+
+bool parseCommandLine(int argc, char** argv, AppOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string_view arg = argv[i];
+		int value = 0;
+
+		if (arg == "--cpu")
+		{
+			options.cpuRender = true;
+		}
+		else if (arg == "--width")
+		{
+			if (!readInt(argc, argv, i, options.width)) return false;
+		}
+		else if (arg == "--height")
+		{
+			if (!readInt(argc, argv, i, options.height)) return false;
+		}
+		else if (arg == "--threads")
+		{
+			if (!readInt(argc, argv, i, value)) return false;
+			options.threads = value > 0 ? static_cast<unsigned>(value) : 0;
+		}
+		else if (arg == "--frames")
+		{
+			if (!readInt(argc, argv, i, options.frames)) return false;
+		}
+		else if (arg == "--output" || arg == "-o")
+		{
+			if (!readString(argc, argv, i, options.outputPath)) return false;
+		}
+		else if (arg == "--adaptive")
+		{
+			options.adaptive = true;
+		}
+		else if (arg == "--tolerance")
+		{
+			if (!readFloat(argc, argv, i, options.tolerance)) return false;
+			options.adaptive = true;
+		}
+		else if (arg == "--lookup")
+		{
+			options.lookup = true;
+		}
+		else if (arg == "--hierarchical")
+		{
+			options.hierarchical = true;
+		}
+		else if (arg == "--lens-cache")
+		{
+			if (!readInt(argc, argv, i, options.lensCacheMB)) return false;
+		}
+		else if (arg == "--trails")
+		{
+			if (!readInt(argc, argv, i, options.trailRays)) return false;
+		}
+		else if (arg == "--photons")
+		{
+			if (!readInt(argc, argv, i, options.photons)) return false;
+		}
+		else if (arg == "--photon-trail")
+		{
+			if (!readInt(argc, argv, i, options.photonTrail)) return false;
+		}
+		else if (arg == "--photon-check")
+		{
+			options.photonCheck = true;
+		}
+		else if (arg == "--caustics")
+		{
+			if (!readInt(argc, argv, i, options.causticRays)) return false;
+		}
+		else if (arg == "--caustic-check")
+		{
+			options.causticCheck = true;
+		}
+		else if (arg == "--sim-rate")
+		{
+			if (!readFloat(argc, argv, i, options.simRate)) return false;
+		}
+		else if (arg == "--render-rate")
+		{
+			if (!readFloat(argc, argv, i, options.renderRate)) return false;
+		}
+		else if (arg == "--profile")
+		{
+			if (!readString(argc, argv, i, options.profilePath)) return false;
+		}
+		else if (arg == "--animate")
+		{
+			options.animate = true;
+		}
+		else if (arg == "--path")
+		{
+			if (!readString(argc, argv, i, options.cameraPathFile)) return false;
+			options.animate = true;
+		}
+		else if (arg == "--fps")
+		{
+			if (!readInt(argc, argv, i, options.fps)) return false;
+		}
+		else if (arg == "--duration")
+		{
+			if (!readFloat(argc, argv, i, options.duration)) return false;
+		}
+		else if (arg == "--record")
+		{
+			if (!readString(argc, argv, i, options.recordPath)) return false;
+		}
+		else if (arg == "--shader-dir")
+		{
+			if (!readString(argc, argv, i, options.shaderDirectory)) return false;
+		}
+		else if (arg == "--shader-cache")
+		{
+			if (!readString(argc, argv, i, options.programCacheDirectory)) return false;
+		}
+		else if (arg == "--no-shader-cache")
+		{
+			options.programCacheDirectory.clear();
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			options.showHelp = true;
+		}
+		else
+		{
+			std::cerr << "ERROR: Unknown argument: " << arg << std::endl;
+			return false;
+		}
+	}
+
+	if (options.width <= 0 || options.height <= 0 || options.frames <= 0)
+	{
+		std::cerr << "ERROR: --width, --height and --frames must be positive" << std::endl;
+		return false;
+	}
+	if (options.trailRays < 0)
+	{
+		std::cerr << "ERROR: --trails can't be negative" << std::endl;
+		return false;
+	}
+	if (options.photons < 0 || options.photonTrail < 2)
+	{
+		std::cerr << "ERROR: --photons can't be negative and --photon-trail needs at least 2 points" << std::endl;
+		return false;
+	}
+	if (options.photonCheck && options.photons == 0)
+	{
+		options.photons = 100000;
+	}
+	if (options.causticRays < 0)
+	{
+		std::cerr << "ERROR: --caustics can't be negative" << std::endl;
+		return false;
+	}
+	if (options.causticCheck && options.causticRays == 0)
+	{
+		options.causticRays = 200000;
+	}
+	if (options.lensCacheMB < 0)
+	{
+		std::cerr << "ERROR: --lens-cache can't be negative" << std::endl;
+		return false;
+	}
+	if (options.simRate <= 0.0f || options.renderRate < 0.0f)
+	{
+		std::cerr << "ERROR: --sim-rate must be positive and --render-rate can't be negative" << std::endl;
+		return false;
+	}
+	if (options.fps <= 0 || options.duration < 0.0f)
+	{
+		std::cerr << "ERROR: --fps must be positive and --duration can't be negative" << std::endl;
+		return false;
+	}
+	if (options.recordPath == "-")
+	{
+		std::cerr << "ERROR: --record can't go to stdout (the window prints its log there), give it a file" << std::endl;
+		return false;
+	}
+	if (options.tolerance <= 0.0f)
+	{
+		std::cerr << "ERROR: --tolerance must be positive" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+void printUsage(const char* programName)
+{
+	std::cout << "Usage: " << programName << " [options]\n"
+	          << "  (no options)       open the interactive window\n"
+	          << "  --cpu              render headless on the CPU (no window, no GPU)\n"
+	          << "  --width N          image width  (default 800)\n"
+	          << "  --height N         image height (default 600)\n"
+	          << "  --threads N        worker threads for --cpu, --caustics and --trails (default: all cores)\n"
+	          << "  --frames N         render N times and report the average rays/second\n"
+	          << "  --output, -o FILE  output image for --cpu (default frame.ppm)\n"
+	          << "  --adaptive         adaptive Dormand-Prince 5(4) steps instead of fixed RK4\n"
+	          << "  --tolerance X      error tolerance per adaptive step (default 1e-4, implies --adaptive)\n"
+	          << "  --lookup           render from the precomputed deflection table (no per-pixel integration)\n"
+	          << "  --hierarchical     trace 8x8 tiles coarse first, refine only the mixed ones\n"
+	          << "  --lens-cache MB    keep traced lens maps for orbiting the camera (default 64, 0 = off)\n"
+	          << "  --trails N         shoot a fan of N light rays in the window and draw their trails\n"
+	          << "  --photons N        stream N photons around the hole on the GPU (compute shader, no CPU work per frame)\n"
+	          << "  --photon-trail N   trail points per photon (default 16)\n"
+	          << "  --photon-check     compare the GPU photons with the CPU integrator and exit (default 100000 photons)\n"
+	          << "  --caustics N       photon density map of N rays (caustics), with --cpu it's written to --output\n"
+	          << "  --caustic-check    compare the GPU caustic map with the CPU one and exit (default 200000 rays)\n"
+	          << "  --sim-rate HZ      simulation steps per second for --trails (default 60)\n"
+	          << "  --render-rate HZ   cap the window's frame rate (default 0 = no cap)\n"
+	          << "  --profile FILE     time every frame and pass, write them to FILE on exit (.json or CSV)\n"
+	          << "  --animate          render a camera fly-around headless (CPU), one image per frame\n"
+	          << "  --path FILE        keyframes for --animate: 'time radius azimuth elevation fov' per line\n"
+	          << "  --fps N            frames per second for --animate (default 30)\n"
+	          << "  --duration S       seconds to render for --animate (default: the whole path)\n"
+	          << "                     --output for --animate: frame_%04d.ppm, movie.y4m, or - (Y4M to stdout)\n"
+	          << "  --record FILE      record the window's frames to FILE (.y4m or PPM pattern, --fps sets the rate tag)\n"
+	          << "  --shader-dir DIR   load shaders from DIR (e.g. ../../../Shaders) instead of the built in ones\n"
+	          << "  --shader-cache DIR keep linked shader programs in DIR (default shader_cache)\n"
+	          << "  --no-shader-cache  always compile the shaders\n"
+	          << "  --help, -h         show this message\n";
+}
@@ -0,0 +1,547 @@
+#include <CpuRenderer.hpp>
+#include <DeflectionTable.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+//same constants as geodesic.comp
+static const float diskInnerMultiplier = 2.5f;
+static const float diskOuterMultiplier = 10.0f;
+
+//the disk crossing test is the shader's own code, compiled here against glm
+namespace shaderCode
+{
+    using namespace glm;
+#include "../Shaders/DiskCrossing.glsl"
+}
+
+glm::vec3 generateRayDirection(glm::vec2 pixelCoord, const TraceParams& params)
+{
+    // Convert pixel to normalized device coordinates (-1 to +1)
+    float u = (2.0f * pixelCoord.x / params.screenSize.x - 1.0f);
+    float v = (2.0f * pixelCoord.y / params.screenSize.y - 1.0f);
+
+    // Account for aspect ratio
+    float aspectRatio = params.screenSize.x / params.screenSize.y;
+    u *= aspectRatio;
+
+    // Account for field of view
+    float tanHalfFov = std::tan(glm::radians(params.cameraFOV) / 2.0f);
+    u *= tanHalfFov;
+    v *= tanHalfFov;
+
+    // Camera always looks at black hole center (in 3D on ground plane Y=0)
+    glm::vec3 blackHoleCenter3D = glm::vec3(params.blackHolePos.x, 0.0f, params.blackHolePos.y);
+
+    glm::vec3 forward = glm::normalize(blackHoleCenter3D - params.cameraPos);
+    glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 right = glm::normalize(glm::cross(forward, worldUp));
+    glm::vec3 up = glm::cross(right, forward);
+
+    return glm::normalize(forward + u * right + v * up);
+}
+
+bool intersectDisk(glm::vec3 rayOrigin, glm::vec3 rayDir, const TraceParams& params, float& hitDistance)
+{
+    // Check if ray is parallel to disk (rayDir.y ~ 0)
+    if (std::abs(rayDir.y) < 0.0001f)
+    {
+        return false;
+    }
+
+    // Calculate where ray crosses Y = 0 plane
+    float t = -rayOrigin.y / rayDir.y;
+    if (t < 0.0f)
+    {
+        return false;  // Intersection is behind the ray origin
+    }
+
+    glm::vec3 hitPoint = rayOrigin + t * rayDir;
+
+    // Distance from black hole center (in XZ plane, Y=0)
+    float distFromCenter = glm::length(glm::vec2(hitPoint.x, hitPoint.z) - params.blackHolePos);
+
+    float innerRadius = params.Rs * diskInnerMultiplier;
+    float outerRadius = params.Rs * diskOuterMultiplier;
+
+    if (distFromCenter >= innerRadius && distFromCenter <= outerRadius)
+    {
+        hitDistance = distFromCenter;
+        return true;
+    }
+
+    return false;
+}
+
+float calculateDiskShading(glm::vec3 rayDir)
+{
+    glm::vec3 diskNormal = glm::vec3(0.0f, 1.0f, 0.0f);
+    float viewAngle = std::abs(glm::dot(glm::normalize(rayDir), diskNormal));
+
+    float ambient = 0.3f;
+    float diffuse = 0.7f;
+
+    return ambient + diffuse * viewAngle;
+}
+
+glm::vec3 getDiskColor(float r, const TraceParams& params)
+{
+    float innerRadius = diskInnerMultiplier * params.Rs;
+    float outerRadius = diskOuterMultiplier * params.Rs;
+    float t = (r - innerRadius) / (outerRadius - innerRadius);
+
+    glm::vec3 innerColor = glm::vec3(1.0f, 1.0f, 0.3f); // Bright yellow
+    glm::vec3 outerColor = glm::vec3(1.0f, 0.8f, 0.0f); // Orange-yellow
+
+    return glm::mix(innerColor, outerColor, t);
+}
+
+glm::vec4 traceGeodesicPixel(glm::ivec2 pixelCoord, const TraceParams& params, IntegratorStats* stats,
+    PixelKind* kind)
+{
+    // write through a dummy when the caller doesn't care
+    PixelKind unusedKind;
+    PixelKind& hit = kind ? *kind : unusedKind;
+
+    // === STEP 1: Generate 3D ray from camera through this pixel ===
+    glm::vec2 pixelPos = glm::vec2(static_cast<float>(pixelCoord.x), static_cast<float>(pixelCoord.y));
+    glm::vec3 rayDir = generateRayDirection(pixelPos, params);
+    glm::vec3 rayOrigin3D = params.cameraPos;
+
+    // === STEP 2: Check if ray hits black hole directly ===
+    float distFromBH = glm::length(glm::vec2(rayOrigin3D.x, rayOrigin3D.z) - params.blackHolePos);
+    if (distFromBH > params.Rs)
+    {
+        glm::vec3 bhCenter3D = glm::vec3(params.blackHolePos.x, 0.0f, params.blackHolePos.y);
+        glm::vec3 toBH = bhCenter3D - rayOrigin3D;
+        float t = glm::dot(toBH, rayDir);
+
+        if (t > 0.0f)
+        {
+            glm::vec3 closestPoint = rayOrigin3D + rayDir * t;
+            float closestDist = glm::length(closestPoint - bhCenter3D);
+            if (closestDist < params.Rs)
+            {
+                hit = PixelKind::Captured;
+                return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    // === STEP 3: Check for immediate disk intersection ===
+    float diskHitDist = 0.0f;
+    if (intersectDisk(rayOrigin3D, rayDir, params, diskHitDist))
+    {
+        glm::vec3 diskColor = getDiskColor(diskHitDist, params);
+        float shading = calculateDiskShading(rayDir);
+        hit = PixelKind::Disk;
+        return glm::vec4(diskColor * shading, 1.0f);
+    }
+
+    // === STEP 3: If no direct hit, trace ray through curved spacetime ===
+    // Traced in 2D polar coordinates in the plane of motion (see geodesic.comp): theta = 0 is the
+    // camera, planeX points from the hole to the camera, planeY along the sideways part of rayDir
+    glm::vec3 bhCenter = glm::vec3(params.blackHolePos.x, 0.0f, params.blackHolePos.y);
+    glm::vec3 cameraOffset = rayOrigin3D - bhCenter;
+    float cameraDistance = glm::length(cameraOffset);
+    glm::vec3 planeX = cameraOffset / cameraDistance;
+    glm::vec3 sideways = rayDir - glm::dot(rayDir, planeX) * planeX;
+    float sidewaysSpeed = glm::length(sideways);
+
+    // A ray straight at or away from the hole doesn't pick a plane, any one holding planeX will do
+    glm::vec3 planeY;
+    if (sidewaysSpeed > 1.0e-6f)
+    {
+        planeY = sideways / sidewaysSpeed;
+    }
+    else
+    {
+        glm::vec3 axis = std::abs(planeX.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        planeY = glm::normalize(glm::cross(planeX, axis));
+    }
+
+    RayState ray;
+    ray.r = cameraDistance;
+    ray.theta = 0.0f;
+
+    float speed = static_cast<float>(C);
+    ray.dr_dlambda = glm::dot(rayDir, planeX) * speed;
+    ray.dtheta_dlambda = sidewaysSpeed * speed / ray.r;
+
+    // Ray tracing parameters (same as the shader)
+    float deltaTime = 0.25f;
+    int maxSteps = 40;
+    float maxDistance = 1000.0f;
+
+    // Adaptive integrator state (shader uniform u_tolerance, constants from dopri5Step)
+    AdaptiveStepSettings adaptive;
+    adaptive.tolerance = params.tolerance;
+    float stepSize = 0.0f;
+
+    glm::vec4 color = glm::vec4(0.6f, 0.8f, 1.0f, 1.0f);  // Pastel blue
+    hit = PixelKind::Escaped;
+
+    // === STEP 4: Trace ray through curved spacetime ===
+    // Where the last step started, its velocity there and how long it was (for the disk test)
+    glm::vec3 previousPoint = rayOrigin3D;
+    glm::vec3 previousVelocity = rayDir * speed;
+    float lastStep = 0.0f;
+    float innerRadius = params.Rs * diskInnerMultiplier;
+    float outerRadius = params.Rs * diskOuterMultiplier;
+
+    for (int step = 0; step < maxSteps; step++)
+    {
+        float cosTheta = std::cos(ray.theta);
+        float sinTheta = std::sin(ray.theta);
+        glm::vec3 outward = cosTheta * planeX + sinTheta * planeY;
+        glm::vec3 sidewaysDir = -sinTheta * planeX + cosTheta * planeY;
+        glm::vec3 rayPoint = bhCenter + ray.r * outward;
+        glm::vec3 rayVelocity = ray.dr_dlambda * outward + (ray.r * ray.dtheta_dlambda) * sidewaysDir;
+
+        float hitDistance = shaderCode::diskCrossingDistance(previousPoint, previousVelocity, rayPoint, rayVelocity,
+            lastStep, bhCenter, innerRadius, outerRadius);
+        if (hitDistance >= 0.0f)
+        {
+            glm::vec3 diskColor = getDiskColor(hitDistance, params);
+            float shading = calculateDiskShading(rayPoint - previousPoint);
+            color = glm::vec4(diskColor * shading, 1.0f);
+            hit = PixelKind::LensedDisk;
+            break;
+        }
+        previousPoint = rayPoint;
+        previousVelocity = rayVelocity;
+
+        if (ray.r < params.Rs)
+        {
+            color = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+            hit = PixelKind::Captured;
+            break;
+        }
+
+        if (ray.r > maxDistance)
+        {
+            break;
+        }
+
+        if (params.integrator == 1)
+        {
+            lastStep = dopri5Step(ray, stepSize, params.Rs, adaptive, stats);
+        }
+        else
+        {
+            ray = rk4Step(ray, deltaTime, params.Rs);
+            lastStep = deltaTime;
+            if (stats)
+            {
+                stats->acceptedSteps++;
+            }
+        }
+    }
+
+    return color;
+}
+
+glm::vec4 traceLookupPixel(glm::ivec2 pixelCoord, const TraceParams& params)
+{
+    const glm::vec4 skyColor = glm::vec4(0.6f, 0.8f, 1.0f, 1.0f);
+    const glm::vec4 shadowColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    const DeflectionTable& table = *params.deflectionTable;
+
+    glm::vec2 pixelPos = glm::vec2(static_cast<float>(pixelCoord.x), static_cast<float>(pixelCoord.y));
+    glm::vec3 rayDir = generateRayDirection(pixelPos, params);
+
+    // Observer radius and the direction pointing away from the hole
+    glm::vec3 bhCenter3D = glm::vec3(params.blackHolePos.x, 0.0f, params.blackHolePos.y);
+    glm::vec3 offset = params.cameraPos - bhCenter3D;
+    float observerRadius = glm::length(offset);
+    glm::vec3 radialDir = offset / observerRadius;
+
+    // Rays heading away from the hole are barely bent: plain straight line test
+    float cosInward = -glm::dot(rayDir, radialDir);
+    if (cosInward < 0.0f)
+    {
+        float diskHitDist = 0.0f;
+        if (intersectDisk(params.cameraPos, rayDir, params, diskHitDist))
+        {
+            return glm::vec4(getDiskColor(diskHitDist, params) * calculateDiskShading(rayDir), 1.0f);
+        }
+        return skyColor;
+    }
+
+    // s = b / r0 is the sideways part of the ray, which is also the second axis of the orbital plane
+    glm::vec3 tangent = rayDir + cosInward * radialDir;
+    float s = glm::length(tangent);
+    if (s < 1.0e-6f)
+    {
+        return shadowColor; // straight down the middle
+    }
+    tangent /= s;
+
+    DeflectionEntry entry = table.sampleEntry(s, observerRadius);
+
+    // The disk plane (Y = 0) cuts the orbital plane where cos(phi) * radial.y + sin(phi) * tangent.y = 0
+    float innerRadius = params.Rs * diskInnerMultiplier;
+    float outerRadius = params.Rs * diskOuterMultiplier;
+    if (std::abs(radialDir.y) > 1.0e-6f || std::abs(tangent.y) > 1.0e-6f)
+    {
+        const float pi = 3.14159265358979323846f;
+        float phiDisk = std::atan2(-radialDir.y, tangent.y);
+        if (phiDisk < 0.0f)
+        {
+            phiDisk += pi;
+        }
+        if (phiDisk >= pi)
+        {
+            phiDisk -= pi;
+        }
+
+        for (int crossing = 0; crossing < table.getSettings().diskCrossings; ++crossing)
+        {
+            float phi = phiDisk + crossing * pi;
+            if (phi > entry.sweptAngle)
+            {
+                break; // path ended before this crossing
+            }
+
+            float r = table.sampleRadius(s, observerRadius, phi);
+            if (r >= innerRadius && r <= outerRadius)
+            {
+                // first crossing is seen head on, later ones are bent images
+                float shading = crossing == 0 ? calculateDiskShading(rayDir) : 0.7f;
+                return glm::vec4(getDiskColor(r, params) * shading, 1.0f);
+            }
+        }
+    }
+
+    return entry.captured > 0.5f ? shadowColor : skyColor;
+}
+
+//float -> rgba8 the same way imageStore does it (clamp then round)
+static unsigned char toUnorm8(float value)
+{
+    float clamped = std::clamp(value, 0.0f, 1.0f);
+    return static_cast<unsigned char>(std::lround(clamped * 255.0f));
+}
+
+CpuRenderer::CpuRenderer(int width, int height, unsigned threadCount, int tileSize)
+    : width(width), height(height), tileSize(tileSize), pool(threadCount)
+{
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+}
+
+int CpuRenderer::getWidth() const
+{
+    return width;
+}
+
+int CpuRenderer::getHeight() const
+{
+    return height;
+}
+
+unsigned CpuRenderer::getThreadCount() const
+{
+    return pool.getThreadCount();
+}
+
+void CpuRenderer::render(const TraceParams& params)
+{
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+
+    //step counters per thread, padded so threads don't share a cache line
+    struct alignas(64) PaddedStats { IntegratorStats value; };
+    std::vector<PaddedStats> threadStats(pool.getThreadCount());
+
+    auto start = std::chrono::steady_clock::now();
+
+    lastStats.pixels = static_cast<unsigned long long>(width) * height;
+    lastStats.tiles = 0;
+    lastStats.refinedTiles = 0;
+
+    if (params.hierarchical && params.renderMode == 0)
+    {
+        std::vector<IntegratorStats*> statsPointers;
+        for (PaddedStats& stats : threadStats)
+        {
+            statsPointers.push_back(&stats.value);
+        }
+        lastStats.rays = renderHierarchical(params, statsPointers);
+    }
+    else
+    {
+        pool.parallelFor(static_cast<size_t>(tilesX) * tilesY, [&](size_t tile, unsigned threadIndex)
+        {
+            renderTile(static_cast<int>(tile), tilesX, params, threadStats[threadIndex].value);
+        });
+        lastStats.rays = lastStats.pixels;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    lastStats.steps = 0;
+    lastStats.rejectedSteps = 0;
+    for (const PaddedStats& stats : threadStats)
+    {
+        lastStats.steps += stats.value.acceptedSteps;
+        lastStats.rejectedSteps += stats.value.rejectedSteps;
+    }
+    lastStats.seconds = std::chrono::duration<double>(end - start).count();
+    lastStats.raysPerSecond = lastStats.seconds > 0.0 ? lastStats.rays / lastStats.seconds : 0.0;
+}
+
+//same passes as Graphics::traceHierarchical / geodesic.comp u_pass 1..3
+unsigned long long CpuRenderer::renderHierarchical(const TraceParams& params, std::vector<IntegratorStats*>& threadStats)
+{
+    const int tilesX = (width + coarseTileSize - 1) / coarseTileSize;
+    const int tilesY = (height + coarseTileSize - 1) / coarseTileSize;
+    const int samplesX = tilesX + 1;
+    const int samplesY = tilesY + 1;
+
+    // Pass 1: one ray per tile corner (a row of corners per task)
+    coarseColors.resize(static_cast<size_t>(samplesX) * samplesY);
+    coarseKinds.resize(coarseColors.size());
+    pool.parallelFor(samplesY, [&](size_t row, unsigned threadIndex)
+    {
+        int sy = static_cast<int>(row);
+        for (int sx = 0; sx < samplesX; ++sx)
+        {
+            size_t index = static_cast<size_t>(sy) * samplesX + sx;
+            coarseColors[index] = traceGeodesicPixel(glm::ivec2(sx * coarseTileSize, sy * coarseTileSize), params,
+                threadStats[threadIndex], &coarseKinds[index]);
+        }
+    });
+
+    // Pass 2: fill tiles whose corners agree, collect the rest (cheap, so single threaded)
+    refineWorkList.clear();
+    for (int ty = 0; ty < tilesY; ++ty)
+    {
+        for (int tx = 0; tx < tilesX; ++tx)
+        {
+            size_t i00 = static_cast<size_t>(ty) * samplesX + tx;
+            size_t i10 = i00 + 1;
+            size_t i01 = i00 + samplesX;
+            size_t i11 = i01 + 1;
+            PixelKind kind = coarseKinds[i00];
+            if (coarseKinds[i10] != kind || coarseKinds[i01] != kind || coarseKinds[i11] != kind)
+            {
+                refineWorkList.push_back(ty * tilesX + tx);
+                continue;
+            }
+
+            // uniform: blend the corner colors over the tile (sky and shadow are flat anyway)
+            int x0 = tx * coarseTileSize;
+            int y0 = ty * coarseTileSize;
+            int x1 = std::min(x0 + coarseTileSize, width);
+            int y1 = std::min(y0 + coarseTileSize, height);
+            for (int y = y0; y < y1; ++y)
+            {
+                float ty01 = static_cast<float>(y - y0) / coarseTileSize;
+                for (int x = x0; x < x1; ++x)
+                {
+                    float tx01 = static_cast<float>(x - x0) / coarseTileSize;
+                    glm::vec4 bottom = glm::mix(coarseColors[i00], coarseColors[i10], tx01);
+                    glm::vec4 top = glm::mix(coarseColors[i01], coarseColors[i11], tx01);
+                    storePixel(x, y, glm::mix(bottom, top, ty01));
+                }
+            }
+        }
+    }
+
+    // Pass 3: trace the mixed tiles at full resolution
+    pool.parallelFor(refineWorkList.size(), [&](size_t slot, unsigned threadIndex)
+    {
+        int tile = refineWorkList[slot];
+        int x0 = (tile % tilesX) * coarseTileSize;
+        int y0 = (tile / tilesX) * coarseTileSize;
+        int x1 = std::min(x0 + coarseTileSize, width);
+        int y1 = std::min(y0 + coarseTileSize, height);
+        for (int y = y0; y < y1; ++y)
+        {
+            for (int x = x0; x < x1; ++x)
+            {
+                storePixel(x, y, traceGeodesicPixel(glm::ivec2(x, y), params, threadStats[threadIndex]));
+            }
+        }
+    });
+
+    lastStats.tiles = static_cast<unsigned long long>(tilesX) * tilesY;
+    lastStats.refinedTiles = refineWorkList.size();
+
+    unsigned long long rays = coarseColors.size();
+    for (int tile : refineWorkList)
+    {
+        int x0 = (tile % tilesX) * coarseTileSize;
+        int y0 = (tile / tilesX) * coarseTileSize;
+        rays += static_cast<unsigned long long>(std::min(coarseTileSize, width - x0)) * std::min(coarseTileSize, height - y0);
+    }
+    return rays;
+}
+
+void CpuRenderer::renderTile(int tileIndex, int tilesX, const TraceParams& params, IntegratorStats& stats)
+{
+    int x0 = (tileIndex % tilesX) * tileSize;
+    int y0 = (tileIndex / tilesX) * tileSize;
+    int x1 = std::min(x0 + tileSize, width);
+    int y1 = std::min(y0 + tileSize, height);
+
+    for (int y = y0; y < y1; ++y)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            glm::vec4 color = (params.renderMode == 1 && params.deflectionTable)
+                ? traceLookupPixel(glm::ivec2(x, y), params)
+                : traceGeodesicPixel(glm::ivec2(x, y), params, &stats);
+            storePixel(x, y, color);
+        }
+    }
+}
+
+void CpuRenderer::storePixel(int x, int y, glm::vec4 color)
+{
+    unsigned char* out = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+    out[0] = toUnorm8(color.x);
+    out[1] = toUnorm8(color.y);
+    out[2] = toUnorm8(color.z);
+    out[3] = toUnorm8(color.w);
+}
+
+const std::vector<unsigned char>& CpuRenderer::getPixels() const
+{
+    return pixels;
+}
+
+const RenderStats& CpuRenderer::getLastStats() const
+{
+    return lastStats;
+}
+
+bool CpuRenderer::writePPM(const std::string& filePath) const
+{
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "ERROR: Could not open output image: " << filePath << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+
+    //texture rows are bottom-up, image rows are top-down
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; --y)
+    {
+        const unsigned char* src = &pixels[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; ++x)
+        {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+
+    return file.good();
+}
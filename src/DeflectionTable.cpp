@@ -0,0 +1,240 @@
+#include <DeflectionTable.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace
+{
+    const float pi = 3.14159265358979323846f;
+
+    // Linear interpolation helpers on a sample axis: position x in [0, count - 1]
+    struct AxisSample
+    {
+        int i0;
+        int i1;
+        float t;
+    };
+
+    AxisSample axisSample(float x, int count)
+    {
+        x = std::clamp(x, 0.0f, static_cast<float>(count - 1));
+        int i0 = std::min(static_cast<int>(x), count - 1);
+        int i1 = std::min(i0 + 1, count - 1);
+        return AxisSample{ i0, i1, x - static_cast<float>(i0) };
+    }
+}
+
+DeflectionTable::DeflectionTable(const BlackHole& blackHole, const DeflectionTableSettings& settings, ThreadPool* pool)
+    : settings(settings), Rs(static_cast<float>(blackHole.schwarzschildRadius))
+{
+    // enough sweep to reach the last disk crossing wherever the first one is
+    maxSweep = static_cast<float>(settings.diskCrossings) * pi;
+
+    size_t pathCount = static_cast<size_t>(settings.impactSamples) * settings.radiusSamples;
+    entries.resize(pathCount);
+    paths.resize(pathCount * settings.angleSamples);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // every observer radius row is independent
+    auto buildRow = [this](size_t radiusIndex, unsigned)
+    {
+        for (int impactIndex = 0; impactIndex < this->settings.impactSamples; ++impactIndex)
+        {
+            buildEntry(impactIndex, static_cast<int>(radiusIndex));
+        }
+    };
+
+    if (pool)
+    {
+        pool->parallelFor(settings.radiusSamples, buildRow);
+    }
+    else
+    {
+        for (int radiusIndex = 0; radiusIndex < settings.radiusSamples; ++radiusIndex)
+        {
+            buildRow(radiusIndex, 0);
+        }
+    }
+
+    buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool DeflectionTable::matches(const BlackHole& blackHole) const
+{
+    return Rs == static_cast<float>(blackHole.schwarzschildRadius);
+}
+
+const DeflectionTableSettings& DeflectionTable::getSettings() const
+{
+    return settings;
+}
+
+float DeflectionTable::getRs() const
+{
+    return Rs;
+}
+
+float DeflectionTable::getMaxSweep() const
+{
+    return maxSweep;
+}
+
+double DeflectionTable::getBuildSeconds() const
+{
+    return buildSeconds;
+}
+
+const std::vector<DeflectionEntry>& DeflectionTable::getEntries() const
+{
+    return entries;
+}
+
+const std::vector<float>& DeflectionTable::getPaths() const
+{
+    return paths;
+}
+
+float DeflectionTable::observerRadiusAt(int index) const
+{
+    float t = static_cast<float>(index) / static_cast<float>(settings.radiusSamples - 1);
+    return settings.minRadius * std::pow(settings.maxRadius / settings.minRadius, t);
+}
+
+float DeflectionTable::radiusCoordinate(float observerRadius) const
+{
+    float clamped = std::clamp(observerRadius, settings.minRadius, settings.maxRadius);
+    return std::log(clamped / settings.minRadius) / std::log(settings.maxRadius / settings.minRadius);
+}
+
+void DeflectionTable::buildEntry(int impactIndex, int radiusIndex)
+{
+    const int angleSamples = settings.angleSamples;
+    const float c = static_cast<float>(C);
+    const float r0 = observerRadiusAt(radiusIndex);
+    const float s = static_cast<float>(impactIndex) / static_cast<float>(settings.impactSamples - 1);
+    const float cosAngle = std::sqrt(std::max(0.0f, 1.0f - s * s));
+
+    // Inward ray in its own orbital plane: starts at theta = 0 and sweeps towards +theta
+    RayState state{ r0, 0.0f, -c * cosAngle, c * s / r0 };
+    float initialDirection = std::atan2(s, -cosAngle);
+
+    // Small steps (at most 5% of r) so the path is well sampled in phi
+    AdaptiveStepSettings adaptive;
+    adaptive.tolerance = settings.tolerance;
+    adaptive.maxStepPerRadius = 0.05f / c;
+
+    const float escapeRadius = std::max(2.0f * r0, 1000.0f);
+    const float angleSpacing = maxSweep / static_cast<float>(angleSamples - 1);
+    const int maxBuildSteps = 100000;
+
+    float* path = &paths[(static_cast<size_t>(radiusIndex) * settings.impactSamples + impactIndex) * angleSamples];
+    path[0] = Rs / r0;
+    int nextSample = 1;
+
+    float previousPhi = 0.0f;
+    float previousU = Rs / r0;
+    float closestRadius = r0;
+    bool captured = false;
+    float stepSize = 0.0f;
+
+    for (int step = 0; step < maxBuildSteps; ++step)
+    {
+        dopri5Step(state, stepSize, Rs, adaptive);
+
+        float phi = state.theta;
+        float u = std::clamp(Rs / state.r, 0.0f, 1.0f);
+
+        // Fill in every angle sample we just stepped over
+        while (nextSample < angleSamples && nextSample * angleSpacing <= phi)
+        {
+            float t = (nextSample * angleSpacing - previousPhi) / std::max(phi - previousPhi, 1.0e-12f);
+            path[nextSample++] = previousU + (u - previousU) * t;
+        }
+        previousPhi = phi;
+        previousU = u;
+        closestRadius = std::min(closestRadius, state.r);
+
+        if (state.r <= Rs)
+        {
+            captured = true;
+            break;
+        }
+        if (state.r > escapeRadius && state.dr_dlambda > 0.0f)
+        {
+            break;
+        }
+        if (phi >= maxSweep)
+        {
+            // still circling the photon sphere after every crossing we care about, treat it as lost
+            captured = true;
+            break;
+        }
+    }
+
+    // Past the end of the path: r = Rs for captured rays, r = infinity for escaped ones
+    for (; nextSample < angleSamples; ++nextSample)
+    {
+        path[nextSample] = captured ? 1.0f : 0.0f;
+    }
+
+    DeflectionEntry& entry = entries[static_cast<size_t>(radiusIndex) * settings.impactSamples + impactIndex];
+    entry.sweptAngle = previousPhi;
+    entry.captured = captured ? 1.0f : 0.0f;
+    entry.closestRadius = closestRadius;
+
+    if (captured)
+    {
+        entry.deflection = 0.0f;
+    }
+    else
+    {
+        float finalDirection = state.theta + std::atan2(state.r * state.dtheta_dlambda, state.dr_dlambda);
+        entry.deflection = finalDirection - initialDirection;
+    }
+}
+
+DeflectionEntry DeflectionTable::sampleEntry(float s, float observerRadius) const
+{
+    AxisSample is = axisSample(s * (settings.impactSamples - 1), settings.impactSamples);
+    AxisSample ir = axisSample(radiusCoordinate(observerRadius) * (settings.radiusSamples - 1), settings.radiusSamples);
+
+    auto at = [this](int impact, int radius) -> const DeflectionEntry&
+    {
+        return entries[static_cast<size_t>(radius) * settings.impactSamples + impact];
+    };
+    auto lerp = [](const DeflectionEntry& a, const DeflectionEntry& b, float t)
+    {
+        return DeflectionEntry{
+            a.sweptAngle + (b.sweptAngle - a.sweptAngle) * t,
+            a.captured + (b.captured - a.captured) * t,
+            a.deflection + (b.deflection - a.deflection) * t,
+            a.closestRadius + (b.closestRadius - a.closestRadius) * t
+        };
+    };
+
+    DeflectionEntry low = lerp(at(is.i0, ir.i0), at(is.i1, ir.i0), is.t);
+    DeflectionEntry high = lerp(at(is.i0, ir.i1), at(is.i1, ir.i1), is.t);
+    return lerp(low, high, ir.t);
+}
+
+float DeflectionTable::sampleRadius(float s, float observerRadius, float phi) const
+{
+    const int angleSamples = settings.angleSamples;
+    AxisSample ia = axisSample(phi / maxSweep * (angleSamples - 1), angleSamples);
+    AxisSample is = axisSample(s * (settings.impactSamples - 1), settings.impactSamples);
+    AxisSample ir = axisSample(radiusCoordinate(observerRadius) * (settings.radiusSamples - 1), settings.radiusSamples);
+
+    auto pathValue = [&](int impact, int radius)
+    {
+        const float* path = &paths[(static_cast<size_t>(radius) * settings.impactSamples + impact) * angleSamples];
+        return path[ia.i0] + (path[ia.i1] - path[ia.i0]) * ia.t;
+    };
+
+    float low = pathValue(is.i0, ir.i0) + (pathValue(is.i1, ir.i0) - pathValue(is.i0, ir.i0)) * is.t;
+    float high = pathValue(is.i0, ir.i1) + (pathValue(is.i1, ir.i1) - pathValue(is.i0, ir.i1)) * is.t;
+    float u = low + (high - low) * ir.t;
+
+    return u > 0.0f ? Rs / u : 1.0e30f;
+}
@@ -0,0 +1,23 @@
+#include <FrameParams.hpp>
+
+FrameParamsBuffer::FrameParamsBuffer()
+{
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameParams), nullptr, GL_DYNAMIC_DRAW);
+
+	//the binding point never changes, so this is the only bind we need
+	glBindBufferBase(GL_UNIFORM_BUFFER, frameParamsBinding, UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+FrameParamsBuffer::~FrameParamsBuffer()
+{
+	glDeleteBuffers(1, &UBO);
+}
+
+void FrameParamsBuffer::update(const FrameParams& params)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameParams), &params);
+}
@@ -0,0 +1,302 @@
+#include <FrameWriter.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+FrameWriter::FrameWriter(FrameFormat format, const std::string& path, int width, int height, int fps, int queueDepth)
+	: format(format), width(width), height(height), fps(fps)
+{
+	if (format == FrameFormat::PPMSequence)
+	{
+		//split "frames/shot_%04d.ppm" around the number. no % means the number goes before the extension.
+		size_t percent = path.find('%');
+		if (percent == std::string::npos)
+		{
+			size_t dot = path.find_last_of('.');
+			size_t slash = path.find_last_of("/\\");
+			if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			{
+				dot = path.size();
+			}
+			pathPrefix = path.substr(0, dot) + "_";
+			pathSuffix = path.substr(dot);
+			numberWidth = 4;
+		}
+		else
+		{
+			size_t end = percent + 1;
+			while (end < path.size() && path[end] >= '0' && path[end] <= '9')
+			{
+				numberWidth = numberWidth * 10 + (path[end] - '0');
+				end++;
+			}
+			if (end >= path.size() || path[end] != 'd' || path.find('%', end) != std::string::npos)
+			{
+				std::cerr << "ERROR: Frame path needs exactly one %d (or %04d ...): " << path << std::endl;
+				return;
+			}
+			pathPrefix = path.substr(0, percent);
+			pathSuffix = path.substr(end + 1);
+		}
+	}
+	else if (path == "-")
+	{
+		stream = stdout;
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY); //no \n -> \r\n in the middle of the pixels
+#endif
+	}
+	else
+	{
+		stream = std::fopen(path.c_str(), "wb");
+		ownsStream = true;
+		if (!stream)
+		{
+			std::cerr << "ERROR: Could not open output video: " << path << std::endl;
+			return;
+		}
+	}
+
+	if (format == FrameFormat::Y4M)
+	{
+		//4:4:4 so no chroma is thrown away, Ip = progressive, A1:1 = square pixels
+		std::fprintf(stream, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", width, height, fps);
+	}
+
+	queueDepth = queueDepth > 0 ? queueDepth : 1;
+	buffers.resize(queueDepth);
+	for (int i = 0; i < queueDepth; ++i)
+	{
+		buffers[i].resize(static_cast<size_t>(width) * height * 4);
+		freeBuffers.push_back(i);
+	}
+
+	opened = true;
+	thread = std::thread(&FrameWriter::writerLoop, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+	finish();
+}
+
+FrameFormat FrameWriter::formatForPath(const std::string& path)
+{
+	bool y4m = path == "-" || (path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0);
+	return y4m ? FrameFormat::Y4M : FrameFormat::PPMSequence;
+}
+
+bool FrameWriter::isOpen() const
+{
+	return opened;
+}
+
+bool FrameWriter::submit(const std::vector<unsigned char>& rgba)
+{
+	if (rgba.size() != static_cast<size_t>(width) * height * 4)
+	{
+		return false;
+	}
+	return submit(rgba.data());
+}
+
+bool FrameWriter::submit(const unsigned char* rgba)
+{
+	if (!opened)
+	{
+		return false;
+	}
+
+	int buffer;
+	{
+		Clock::time_point waitStart = Clock::now();
+		std::unique_lock<std::mutex> lock(mutex);
+		freeCondition.wait(lock, [this]() { return !freeBuffers.empty() || failed; });
+		waitSeconds += secondsSince(waitStart);
+		if (failed)
+		{
+			return false;
+		}
+		buffer = freeBuffers.front();
+		freeBuffers.pop_front();
+	}
+
+	//the buffer belongs to us until it's in readyBuffers, so no lock needed for the copy
+	std::copy(rgba, rgba + buffers[buffer].size(), buffers[buffer].begin());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		readyBuffers.push_back(buffer);
+	}
+	readyCondition.notify_one();
+	return true;
+}
+
+bool FrameWriter::finish()
+{
+	if (thread.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		readyCondition.notify_one();
+		thread.join();
+	}
+
+	if (stream)
+	{
+		if (std::fflush(stream) != 0)
+		{
+			failed = true;
+		}
+		if (ownsStream)
+		{
+			std::fclose(stream);
+		}
+		stream = nullptr;
+	}
+	return opened && !failed;
+}
+
+int FrameWriter::getFramesWritten() const
+{
+	return framesWritten;
+}
+
+double FrameWriter::getWaitSeconds() const
+{
+	return waitSeconds;
+}
+
+double FrameWriter::getWriteSeconds() const
+{
+	return writeSeconds;
+}
+
+void FrameWriter::writerLoop()
+{
+	while (true)
+	{
+		int buffer;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			readyCondition.wait(lock, [this]() { return !readyBuffers.empty() || stopping; });
+			if (readyBuffers.empty())
+			{
+				return; //stopping and nothing left to write
+			}
+			buffer = readyBuffers.front();
+			readyBuffers.pop_front();
+		}
+
+		Clock::time_point writeStart = Clock::now();
+		bool written = !failed && writeFrame(framesWritten, buffers[buffer]);
+		double seconds = secondsSince(writeStart);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			writeSeconds += seconds;
+			if (written)
+			{
+				framesWritten++;
+			}
+			else
+			{
+				failed = true;
+			}
+			freeBuffers.push_back(buffer);
+		}
+		freeCondition.notify_one();
+	}
+}
+
+bool FrameWriter::writeFrame(int frameIndex, const std::vector<unsigned char>& rgba)
+{
+	return format == FrameFormat::Y4M ? writeY4M(rgba) : writePPM(frameIndex, rgba);
+}
+
+bool FrameWriter::writePPM(int frameIndex, const std::vector<unsigned char>& rgba)
+{
+	std::string number = std::to_string(frameIndex);
+	if (static_cast<int>(number.size()) < numberWidth)
+	{
+		number.insert(0, numberWidth - number.size(), '0');
+	}
+	std::string filePath = pathPrefix + number + pathSuffix;
+
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open output image: " << filePath << std::endl;
+		return false;
+	}
+
+	//RGBA bottom-up -> RGB top-down (same as CpuRenderer::writePPM)
+	encoded.resize(static_cast<size_t>(width) * height * 3);
+	unsigned char* dst = encoded.data();
+	for (int y = height - 1; y >= 0; --y)
+	{
+		const unsigned char* src = &rgba[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; ++x)
+		{
+			*dst++ = src[x * 4 + 0];
+			*dst++ = src[x * 4 + 1];
+			*dst++ = src[x * 4 + 2];
+		}
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+	if (!file.good())
+	{
+		std::cerr << "ERROR: Could not write output image: " << filePath << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool FrameWriter::writeY4M(const std::vector<unsigned char>& rgba)
+{
+	//BT.601 limited range (what players assume for Y4M without a colour tag), planes Y, Cb, Cr
+	size_t planeSize = static_cast<size_t>(width) * height;
+	encoded.resize(planeSize * 3);
+	unsigned char* planeY = encoded.data();
+	unsigned char* planeU = planeY + planeSize;
+	unsigned char* planeV = planeU + planeSize;
+
+	size_t out = 0;
+	for (int y = height - 1; y >= 0; --y)
+	{
+		const unsigned char* src = &rgba[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; ++x, ++out)
+		{
+			int r = src[x * 4 + 0];
+			int g = src[x * 4 + 1];
+			int b = src[x * 4 + 2];
+			planeY[out] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+			planeU[out] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+			planeV[out] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+		}
+	}
+
+	if (std::fputs("FRAME\n", stream) < 0 || std::fwrite(encoded.data(), 1, encoded.size(), stream) != encoded.size())
+	{
+		std::cerr << "ERROR: Could not write video frame" << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -1,10 +1,12 @@
 #include <glm/glm.hpp>
 #include <Graphics.hpp>
+#include <DeflectionTable.hpp>
 
 
-Graphics::Graphics(int width, int height)
-	: width(width), height(height), computeTexture(0), quadMesh(nullptr)
+Graphics::Graphics(int width, int height, int targetCount)
+	: width(width), height(height), quadMesh(nullptr)
 {
+	targets.resize(targetCount > 0 ? targetCount : 1);
 	createTexture();
 
 	// Create fullscreen quad mesh
@@ -23,9 +25,32 @@ Graphics::Graphics(int width, int height)
 //destructor
 Graphics::~Graphics()
 {
-	// Cleanup texture
-	if (computeTexture != 0) {
-		glDeleteTextures(1, &computeTexture);
+	// Cleanup textures (the GPU is done with everything by now)
+	retireTextures();
+	for (size_t i = 0; i < retiredTextures.size(); ++i) {
+		glDeleteTextures(1, &retiredTextures[i].texture);
+		if (i + 1 == retiredTextures.size() || retiredTextures[i + 1].fence != retiredTextures[i].fence) {
+			glDeleteSync(retiredTextures[i].fence);
+		}
+	}
+
+	// Cleanup coarse-to-fine buffers
+	if (coarseSampleBuffer != 0) {
+		glDeleteBuffers(1, &coarseSampleBuffer);
+	}
+	if (refineWorkListBuffer != 0) {
+		glDeleteBuffers(1, &refineWorkListBuffer);
+	}
+
+	// Cleanup readback ring
+	deleteReadbackBuffers();
+
+	// Cleanup deflection table textures
+	if (deflectionPathTexture != 0) {
+		glDeleteTextures(1, &deflectionPathTexture);
+	}
+	if (deflectionEntryTexture != 0) {
+		glDeleteTextures(1, &deflectionEntryTexture);
 	}
 
 	// Cleanup mesh
@@ -46,23 +71,111 @@ int Graphics::getHeight() const
 
 void Graphics::createTexture()
 {
-	// Delete old texture if it exists
-	if (computeTexture != 0) {
-		glDeleteTextures(1, &computeTexture);
+	// Old textures may still be in use by frames in flight, they go away once those are done
+	retireTextures();
+
+	// Immutable storage for every output target: the size is fixed until the next resize
+	for (RenderTarget& target : targets) {
+		glCreateTextures(GL_TEXTURE_2D, 1, &target.texture);
+		glTextureStorage2D(target.texture, 1, GL_RGBA8, width, height);
+		glTextureParameteri(target.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTextureParameteri(target.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTextureParameteri(target.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(target.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glClearTexImage(target.texture, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);  // black until the first trace
 	}
+	writeTarget = 0;
+	latestTarget = -1;
+	presentTarget = -1;
 
-	// Generate new texture
-	glGenTextures(1, &computeTexture);
-	glBindTexture(GL_TEXTURE_2D, computeTexture);
+	// Float texture the compute shader sums its samples into while the view stays still
+	// (only ever touched with imageLoad/imageStore, so no filtering needed)
+	glCreateTextures(GL_TEXTURE_2D, 1, &accumulationTexture);
+	glTextureStorage2D(accumulationTexture, 1, GL_RGBA32F, width, height);
+	glTextureParameteri(accumulationTexture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(accumulationTexture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glClearTexImage(accumulationTexture, 0, GL_RGBA, GL_FLOAT, nullptr);  // no stale sums from an old size
 
-	// Allocate texture storage
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
-		GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	// the coarse-to-fine buffers depend on the size too
+	createHierarchyBuffers();
 
-	// Setup texture parameters
-	setupTextureParameters();
+	std::cout << "Compute textures created: " << targets.size() << " x " << width << "x" << height << std::endl;
+}
+
+void Graphics::retireTextures()
+{
+	bool any = accumulationTexture != 0;
+	for (RenderTarget& target : targets) {
+		any = any || target.texture != 0;
+	}
+	if (!any) {
+		return;
+	}
+
+	//one fence behind everything queued so far covers all of them
+	GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	for (RenderTarget& target : targets) {
+		if (target.computeDone) {
+			glDeleteSync(target.computeDone);
+		}
+		if (target.presentDone) {
+			glDeleteSync(target.presentDone);
+		}
+		if (target.texture != 0) {
+			retiredTextures.push_back(RetiredTexture{ target.texture, fence });
+		}
+		target = RenderTarget();
+	}
+	if (accumulationTexture != 0) {
+		retiredTextures.push_back(RetiredTexture{ accumulationTexture, fence });
+		accumulationTexture = 0;
+	}
+}
+
+void Graphics::releaseRetiredTextures()
+{
+	// They were retired in order, so stop at the first fence that hasn't passed
+	size_t released = 0;
+	while (released < retiredTextures.size()) {
+		GLsync fence = retiredTextures[released].fence;
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			break;
+		}
 
-	std::cout << "Compute texture created: " << width << "x" << height << std::endl;
+		// several textures share a fence, delete it with the last of them
+		glDeleteTextures(1, &retiredTextures[released].texture);
+		released++;
+		if (released == retiredTextures.size() || retiredTextures[released].fence != fence) {
+			glDeleteSync(fence);
+		}
+	}
+	retiredTextures.erase(retiredTextures.begin(), retiredTextures.begin() + released);
+}
+
+// must match coarseTileSize and the CoarseSamples / RefineWorkList blocks in geodesic.comp
+static const int coarseTileSize = 8;
+static const GLsizeiptr coarseSampleStride = 32;      // vec4 color + int kind, padded to 16 (std430)
+static const GLsizeiptr workListHeaderSize = 4 * sizeof(GLuint);  // numGroups xyz + tileCount
+
+void Graphics::createHierarchyBuffers()
+{
+	if (coarseSampleBuffer == 0) {
+		glGenBuffers(1, &coarseSampleBuffer);
+	}
+	if (refineWorkListBuffer == 0) {
+		glGenBuffers(1, &refineWorkListBuffer);
+	}
+
+	int tilesX = (width + coarseTileSize - 1) / coarseTileSize;
+	int tilesY = (height + coarseTileSize - 1) / coarseTileSize;
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, coarseSampleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, coarseSampleStride * (tilesX + 1) * (tilesY + 1), nullptr, GL_DYNAMIC_COPY);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, refineWorkListBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, workListHeaderSize + sizeof(GLuint) * tilesX * tilesY, nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
 void Graphics::setupTextureParameters()
@@ -73,44 +186,117 @@ void Graphics::setupTextureParameters()
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
-void Graphics::resize(int newWidth, int newHeight)
+bool Graphics::resize(int newWidth, int newHeight)
 {
-	//check if theres no change in the size.
-	if(newWidth == width && newHeight == height)
+	//check if theres no change in the size (or the window is minimized).
+	if((newWidth == width && newHeight == height) || newWidth <= 0 || newHeight <= 0)
 	{
-		return; //return if true
+		return false; //return if true
 	}
 
 	//if not 
 	//update the width and height
 	width = newWidth;
 	height = newHeight;
-	createTexture(); //recreate the texture with new size
+	createTexture(); //new textures with the new size, the old ones are retired (no glFinish)
 	bindForCompute();
+
+	//readbacks still in flight have the old size, they're dropped with the old buffers
+	if (!readbackSlots.empty())
+	{
+		createReadbackBuffers(static_cast<int>(readbackSlots.size()));
+	}
+	return true;
 }
 
 GLuint Graphics::getTexture() const
 {
-	return computeTexture;
+	return targets[latestTarget >= 0 ? latestTarget : 0].texture;
+}
+
+GLuint Graphics::getAccumulationTexture() const
+{
+	return accumulationTexture;
+}
+
+int Graphics::getTargetCount() const
+{
+	return static_cast<int>(targets.size());
 }
 
 void Graphics::bindForCompute()
 {
+	// The quad may still be sampling this target from an earlier frame: let the GPU wait for
+	// that (glWaitSync doesn't block the CPU) before the compute shader writes over it
+	RenderTarget& target = targets[writeTarget];
+	if (target.presentDone) {
+		glWaitSync(target.presentDone, 0, GL_TIMEOUT_IGNORED);
+		glDeleteSync(target.presentDone);
+		target.presentDone = nullptr;
+	}
+
 	// Bind texture as image unit 0 for compute shader (write-only)
-	glBindImageTexture(0, computeTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glBindImageTexture(0, target.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	// Accumulation sum is read and written
+	glBindImageTexture(1, accumulationTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+}
+
+void Graphics::endCompute()
+{
+	//the image writes have to be visible to imageLoad (accumulation) and texture() (the quad) later on
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	RenderTarget& target = targets[writeTarget];
+	if (target.computeDone) {
+		glDeleteSync(target.computeDone);
+	}
+	target.computeDone = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	latestTarget = writeTarget;
+
+	// The next frame writes the next target that isn't on screen
+	int count = static_cast<int>(targets.size());
+	writeTarget = (writeTarget + 1) % count;
+	if (writeTarget == presentTarget && count > 2) {
+		writeTarget = (writeTarget + 1) % count;
+	}
 }
 
 void Graphics::renderQuad(Shader& quadShader)
 {
+	releaseRetiredTextures();
+
+	// Switch to the newest finished frame once the GPU is done tracing it. Until then keep showing
+	// the previous one, so the quad never waits for the compute pass. (Nothing on screen yet: take it
+	// anyway, the GPU runs the commands in order.)
+	if (latestTarget >= 0 && latestTarget != presentTarget) {
+		RenderTarget& latest = targets[latestTarget];
+		GLenum result = latest.computeDone ? glClientWaitSync(latest.computeDone, GL_SYNC_FLUSH_COMMANDS_BIT, 0)
+			: GL_ALREADY_SIGNALED;
+		if (result != GL_TIMEOUT_EXPIRED || presentTarget < 0) {
+			if (latest.computeDone) {
+				glDeleteSync(latest.computeDone);
+				latest.computeDone = nullptr;
+			}
+			presentTarget = latestTarget;
+		}
+	}
+	RenderTarget& shown = targets[presentTarget >= 0 ? presentTarget : 0];
+
 	// Use the shader
 	quadShader.Use();
 
 	// Bind texture for sampling
-	glBindTexture(GL_TEXTURE_2D, computeTexture);
+	glBindTexture(GL_TEXTURE_2D, shown.texture);
 	quadShader.SetInt("screenTexture", 0);  // Texture unit 0
 
 	// Draw the fullscreen quad
 	quadMesh->draw();
+
+	// The compute pass waits for this before it writes into the texture again
+	if (shown.presentDone) {
+		glDeleteSync(shown.presentDone);
+	}
+	shown.presentDone = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 }
 
 void Graphics::getWorkGroups(int& outX, int& outY) const
@@ -119,4 +305,248 @@ void Graphics::getWorkGroups(int& outX, int& outY) const
 	// Round up division
 	outX = (width + 15) / 16;
 	outY = (height + 15) / 16;
-}
\ No newline at end of file
+}
+
+int Graphics::getTileCount() const
+{
+	return ((width + coarseTileSize - 1) / coarseTileSize) * ((height + coarseTileSize - 1) / coarseTileSize);
+}
+
+void Graphics::traceHierarchical(Shader& computeShader)
+{
+	int tilesX = (width + coarseTileSize - 1) / coarseTileSize;
+	int tilesY = (height + coarseTileSize - 1) / coarseTileSize;
+
+	// Empty work list: 0 work groups (x), 1 (y), 1 (z), 0 tiles
+	const GLuint emptyWorkList[4] = { 0, 1, 1, 0 };
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, refineWorkListBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(emptyWorkList), emptyWorkList);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, coarseSampleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, refineWorkListBuffer);
+
+	computeShader.Use();
+
+	// Pass 1: one ray per tile corner
+	computeShader.SetInt("u_pass", 1);
+	glDispatchCompute((tilesX + 1 + 15) / 16, (tilesY + 1 + 15) / 16, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// Pass 2: fill uniform tiles, put mixed ones on the work list (one invocation per tile)
+	computeShader.SetInt("u_pass", 2);
+	glDispatchCompute((tilesX + 15) / 16, (tilesY + 15) / 16, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+	// Pass 3: the GPU already wrote how many work groups the refine pass needs
+	computeShader.SetInt("u_pass", 3);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, refineWorkListBuffer);
+	glDispatchComputeIndirect(0);
+	glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+	computeShader.SetInt("u_pass", 0);
+}
+
+GLuint Graphics::readRefinedTileCount() const
+{
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	GLuint tileCount = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, refineWorkListBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(GLuint), sizeof(GLuint), &tileCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	return tileCount;
+}
+
+void Graphics::uploadDeflectionTable(const DeflectionTable& table)
+{
+	const DeflectionTableSettings& settings = table.getSettings();
+
+	if (deflectionPathTexture == 0) {
+		glGenTextures(1, &deflectionPathTexture);
+	}
+	if (deflectionEntryTexture == 0) {
+		glGenTextures(1, &deflectionEntryTexture);
+	}
+
+	// Paths: one float (Rs / r) per sample, filtered in all three directions
+	glBindTexture(GL_TEXTURE_3D, deflectionPathTexture);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, settings.angleSamples, settings.impactSamples, settings.radiusSamples,
+		0, GL_RED, GL_FLOAT, table.getPaths().data());
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+	// Entries: DeflectionEntry is 4 floats, so it maps straight onto RGBA32F
+	glBindTexture(GL_TEXTURE_2D, deflectionEntryTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, settings.impactSamples, settings.radiusSamples,
+		0, GL_RGBA, GL_FLOAT, table.getEntries().data());
+	setupTextureParameters();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	tableMinRadius = settings.minRadius;
+	tableMaxRadius = settings.maxRadius;
+	tableMaxSweep = table.getMaxSweep();
+	tableCrossings = settings.diskCrossings;
+
+	std::cout << "Deflection table uploaded: " << settings.impactSamples << "x" << settings.radiusSamples
+		<< " paths, " << settings.angleSamples << " samples each" << std::endl;
+}
+
+bool Graphics::hasDeflectionTable() const
+{
+	return deflectionPathTexture != 0;
+}
+
+void Graphics::bindDeflectionTable(Shader& computeShader)
+{
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, deflectionPathTexture);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, deflectionEntryTexture);
+	glActiveTexture(GL_TEXTURE0); // renderQuad samples from unit 0
+
+	computeShader.SetFloat("u_tableMinRadius", tableMinRadius);
+	computeShader.SetFloat("u_tableMaxRadius", tableMaxRadius);
+	computeShader.SetFloat("u_tableMaxSweep", tableMaxSweep);
+	computeShader.SetInt("u_tableCrossings", tableCrossings);
+}
+
+void Graphics::enableReadback(int ringSize)
+{
+	createReadbackBuffers(ringSize > 0 ? ringSize : 1);
+}
+
+void Graphics::disableReadback()
+{
+	deleteReadbackBuffers();
+}
+
+bool Graphics::isReadbackEnabled() const
+{
+	return !readbackSlots.empty();
+}
+
+void Graphics::createReadbackBuffers(int ringSize)
+{
+	deleteReadbackBuffers();
+
+	GLsizeiptr frameSize = static_cast<GLsizeiptr>(width) * height * 4;
+	const GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	readbackSlots.resize(ringSize);
+	for (ReadbackSlot& slot : readbackSlots)
+	{
+		//immutable storage mapped once, the consumer reads straight out of it (no copy into a vector)
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glBufferStorage(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, flags);
+		slot.mapped = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameSize, flags));
+		if (!slot.mapped)
+		{
+			std::cerr << "ERROR: Could not map the readback buffer, readback is off" << std::endl;
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			deleteReadbackBuffers();
+			return;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void Graphics::deleteReadbackBuffers()
+{
+	for (ReadbackSlot& slot : readbackSlots)
+	{
+		if (slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		if (slot.mapped)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		if (slot.buffer != 0)
+		{
+			glDeleteBuffers(1, &slot.buffer);
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	readbackSlots.clear();
+	readbackNext = 0;
+	readbackOldest = 0;
+	readbacksInFlight = 0;
+}
+
+bool Graphics::requestReadback(uint64_t frame)
+{
+	if (readbackSlots.empty())
+	{
+		return false;
+	}
+	if (readbacksInFlight == static_cast<int>(readbackSlots.size()))
+	{
+		droppedReadbacks++; //the consumer is a whole ring behind, skip this frame rather than stall
+		return false;
+	}
+
+	ReadbackSlot& slot = readbackSlots[readbackNext];
+
+	//the compute shader wrote the texture with imageStore, make that visible to the copy
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+	//with a pack buffer bound the "pointer" is an offset into it, so this only queues the copy
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glBindTexture(GL_TEXTURE_2D, getTexture());
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frame = frame;
+
+	readbackNext = (readbackNext + 1) % static_cast<int>(readbackSlots.size());
+	readbacksInFlight++;
+	return true;
+}
+
+int Graphics::collectReadbacks(const ReadbackConsumer& consumer, bool wait)
+{
+	int collected = 0;
+	while (readbacksInFlight > 0)
+	{
+		ReadbackSlot& slot = readbackSlots[readbackOldest];
+
+		//timeout 0 just asks, the flush makes sure the fence gets to the GPU at all
+		GLuint64 timeout = wait ? 1000000000 : 0;  // 1 second
+		GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			if (wait)
+			{
+				continue;
+			}
+			break; //not there yet, and the later ones can't be either
+		}
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+		if (result != GL_WAIT_FAILED)
+		{
+			consumer(slot.mapped, width, height, slot.frame);
+			collected++;
+		}
+
+		readbackOldest = (readbackOldest + 1) % static_cast<int>(readbackSlots.size());
+		readbacksInFlight--;
+	}
+	return collected;
+}
+
+uint64_t Graphics::getDroppedReadbacks() const
+{
+	return droppedReadbacks;
+}
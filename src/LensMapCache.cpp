@@ -0,0 +1,167 @@
+#include <LensMapCache.hpp>
+#include <cmath>
+#include <functional>
+
+// image unit of lensMapImage, must match Shaders/geodesic.comp
+static const GLuint lensMapUnit = 2;
+
+// geodesic.comp u_pass values
+static const int passLensTrace = 4;
+static const int passLensShade = 5;
+
+size_t LensMapKeyHash::operator()(const LensMapKey& key) const
+{
+	size_t hash = std::hash<int>()(key.radiusBucket);
+	hash = hash * 31 + std::hash<int>()(key.elevationBucket);
+	hash = hash * 31 + std::hash<float>()(key.fov);
+	hash = hash * 31 + std::hash<int>()(key.width);
+	return hash * 31 + std::hash<int>()(key.height);
+}
+
+LensMapCache::LensMapCache(size_t maxBytes, const LensMapSettings& settings)
+	: settings(settings), maxBytes(maxBytes)
+{
+}
+
+LensMapCache::~LensMapCache()
+{
+	clear();
+}
+
+LensMapKey LensMapCache::keyFor(const Camera& camera, int width, int height) const
+{
+	//same clamp as Camera::getPosition, elevations past it all give the same picture
+	float elevation = std::fmin(std::fmax(camera.elevation, camera.minElevation), camera.maxElevation);
+
+	LensMapKey key;
+	key.radiusBucket = static_cast<int>(std::lround(std::log(camera.radius) / std::log1p(settings.radiusStep)));
+	key.elevationBucket = static_cast<int>(std::lround(elevation / settings.elevationStep));
+	key.fov = camera.fov;
+	key.width = width;
+	key.height = height;
+	return key;
+}
+
+Camera LensMapCache::bucketCamera(const LensMapKey& key, const Camera& camera) const
+{
+	Camera bucket = camera;
+	bucket.radius = std::exp(static_cast<float>(key.radiusBucket) * std::log1p(settings.radiusStep));
+	bucket.elevation = static_cast<float>(key.elevationBucket) * settings.elevationStep;
+	return bucket;
+}
+
+GLuint LensMapCache::find(const LensMapKey& key)
+{
+	auto found = index.find(key);
+	if (found == index.end())
+	{
+		++misses;
+		return 0;
+	}
+
+	//move it to the front, the list iterators stay valid
+	entries.splice(entries.begin(), entries, found->second);
+	++hits;
+	return found->second->texture;
+}
+
+GLuint LensMapCache::insert(const LensMapKey& key)
+{
+	size_t bytes = mapBytes(key.width, key.height);
+	if (bytes > maxBytes)
+	{
+		return 0;
+	}
+	while (usedBytes + bytes > maxBytes)
+	{
+		evictLeastRecent();
+	}
+
+	Entry entry;
+	entry.key = key;
+	entry.bytes = bytes;
+	//only ever touched with imageLoad/imageStore, like the accumulation texture
+	glCreateTextures(GL_TEXTURE_2D, 1, &entry.texture);
+	glTextureStorage2D(entry.texture, 1, GL_RGBA32F, key.width, key.height);
+	glTextureParameteri(entry.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(entry.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	entries.push_front(entry);
+	index[key] = entries.begin();
+	usedBytes += bytes;
+	return entry.texture;
+}
+
+void LensMapCache::evictLeastRecent()
+{
+	//the GL keeps the texture alive until the commands still using it are done
+	Entry& oldest = entries.back();
+	glDeleteTextures(1, &oldest.texture);
+	usedBytes -= oldest.bytes;
+	index.erase(oldest.key);
+	entries.pop_back();
+	++evictions;
+}
+
+void LensMapCache::dispatch(Shader& computeShader, int pass, GLuint map, GLenum access, int width, int height)
+{
+	computeShader.Use();
+	computeShader.SetInt("u_pass", pass);
+	glBindImageTexture(lensMapUnit, map, 0, GL_FALSE, 0, access, GL_RGBA32F);
+	// 16x16 work groups, same as Graphics::getWorkGroups
+	glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+	computeShader.SetInt("u_pass", 0);
+}
+
+void LensMapCache::trace(Shader& computeShader, GLuint map, int width, int height)
+{
+	dispatch(computeShader, passLensTrace, map, GL_WRITE_ONLY, width, height);
+	//the shade pass reads it with imageLoad
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void LensMapCache::shade(Shader& computeShader, GLuint map, int width, int height)
+{
+	dispatch(computeShader, passLensShade, map, GL_READ_ONLY, width, height);
+}
+
+void LensMapCache::clear()
+{
+	for (Entry& entry : entries)
+	{
+		glDeleteTextures(1, &entry.texture);
+	}
+	entries.clear();
+	index.clear();
+	usedBytes = 0;
+}
+
+size_t LensMapCache::mapBytes(int width, int height)
+{
+	return static_cast<size_t>(width) * height * 4 * sizeof(float);
+}
+
+size_t LensMapCache::getMapCount() const
+{
+	return entries.size();
+}
+
+size_t LensMapCache::memoryBytes() const
+{
+	return usedBytes;
+}
+
+uint64_t LensMapCache::getHits() const
+{
+	return hits;
+}
+
+uint64_t LensMapCache::getMisses() const
+{
+	return misses;
+}
+
+uint64_t LensMapCache::getEvictions() const
+{
+	return evictions;
+}
@@ -1,53 +1,173 @@
 #include <Mesh.hpp>
+#include <algorithm>
+#include <utility>
 //mesh constructor
  // General constructor: pass stride (in bytes) and attribute layout info
-Mesh::Mesh(float* vertices, size_t size, GLsizei count,
+Mesh::Mesh(const float* vertices, size_t size, GLsizei count,
     const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride)
 {
     vertexCount = count;
+    createVertexArray(vertices, size, attributes, stride);
+}
 
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+Mesh::Mesh(const float* vertices, size_t size, GLsizei count, const std::vector<GLuint>& indices,
+    const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride)
+{
+    vertexCount = count;
+    indexCount = static_cast<GLsizei>(indices.size());
+    createVertexArray(vertices, size, attributes, stride);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+    glCreateBuffers(1, &EBO);
+    glNamedBufferStorage(EBO, indices.size() * sizeof(GLuint), indices.data(), 0);
+    glVertexArrayElementBuffer(VAO, EBO);
+}
+
+Mesh::~Mesh()
+{
+    release();
+}
+
+Mesh::Mesh(Mesh&& other) noexcept
+    : VAO(0), VBO(0), vertexCount(0)
+{
+    *this = std::move(other);
+}
+
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        VAO = std::exchange(other.VAO, 0);
+        VBO = std::exchange(other.VBO, 0);
+        EBO = std::exchange(other.EBO, 0);
+        instanceVBO = std::exchange(other.instanceVBO, 0);
+        vertexCount = other.vertexCount;
+        indexCount = other.indexCount;
+        instanceCount = other.instanceCount;
+        instanceStride = other.instanceStride;
+        maxInstanceCount = other.maxInstanceCount;
+        color = other.color;
+    }
+    return *this;
+}
+
+void Mesh::release()
+{
+    GLuint buffers[] = { VBO, EBO, instanceVBO };
+    for (GLuint buffer : buffers)
+    {
+        if (buffer != 0)
+        {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    if (VAO != 0)
+    {
+        glDeleteVertexArrays(1, &VAO);
+    }
+    VAO = VBO = EBO = instanceVBO = 0;
+}
+
+void Mesh::createVertexArray(const float* vertices, size_t size,
+    const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride)
+{
+    //immutable storage (no flags): the data is uploaded once and never touched again
+    glCreateBuffers(1, &VBO);
+    glNamedBufferStorage(VBO, size, vertices, 0);
 
+    glCreateVertexArrays(1, &VAO);
+    glVertexArrayVertexBuffer(VAO, meshVertexBinding, VBO, 0, stride);
+    setupAttributes(meshVertexBinding, attributes);
+}
+
+void Mesh::setupAttributes(GLuint binding, const std::vector<std::pair<GLuint, GLint>>& attributes)
+{
+    GLuint offset = 0;
     for (size_t i = 0; i < attributes.size(); ++i)
     {
         GLuint index = attributes[i].first;   // attribute location
         GLint sizeAttr = attributes[i].second; // number of floats
-        GLintptr offset = 0;
-        for (size_t j = 0; j < i; ++j)
-            offset += attributes[j].second * sizeof(float);
 
-        glVertexAttribPointer(index, sizeAttr, GL_FLOAT, GL_FALSE, stride, (void*)offset);
-        glEnableVertexAttribArray(index);
+        glEnableVertexArrayAttrib(VAO, index);
+        glVertexArrayAttribFormat(VAO, index, sizeAttr, GL_FLOAT, GL_FALSE, offset);
+        glVertexArrayAttribBinding(VAO, index, binding);
+        offset += sizeAttr * sizeof(float);
     }
+}
+
+void Mesh::setInstanceData(const float* data, GLsizei count, GLsizei maxInstances,
+    const std::vector<std::pair<GLuint, GLint>>& attributes, GLsizei stride)
+{
+    if (instanceVBO != 0)
+    {
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    maxInstanceCount = std::max(maxInstances, count);
+    instanceStride = stride;
+
+    //dynamic storage so updateInstanceData can rewrite it with glNamedBufferSubData
+    glCreateBuffers(1, &instanceVBO);
+    glNamedBufferStorage(instanceVBO, static_cast<GLsizeiptr>(maxInstanceCount) * stride, nullptr,
+        GL_DYNAMIC_STORAGE_BIT);
+
+    glVertexArrayVertexBuffer(VAO, meshInstanceBinding, instanceVBO, 0, stride);
+    glVertexArrayBindingDivisor(VAO, meshInstanceBinding, 1);
+    setupAttributes(meshInstanceBinding, attributes);
+
+    updateInstanceData(data, count);
+}
 
-    glBindVertexArray(0);
+void Mesh::updateInstanceData(const float* data, GLsizei count)
+{
+    if (instanceVBO == 0)
+    {
+        return;
+    }
+    instanceCount = std::min(count, maxInstanceCount);
+    if (data != nullptr && instanceCount > 0)
+    {
+        glNamedBufferSubData(instanceVBO, 0, static_cast<GLsizeiptr>(instanceCount) * instanceStride, data);
+    }
 }
 
 //draw function.
-void Mesh::draw()
+//the VAO stays bound afterwards, nothing edits VAOs through bindings any more (everything is DSA)
+void Mesh::submit(GLenum mode, GLsizei instances)
 {
     glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, vertexCount);
-    glBindVertexArray(0);
+    if (EBO != 0)
+    {
+        glDrawElementsInstanced(mode, indexCount, GL_UNSIGNED_INT, nullptr, instances);
+    }
+    else
+    {
+        glDrawArraysInstanced(mode, 0, vertexCount, instances);
+    }
+}
+
+void Mesh::draw()
+{
+    submit(GL_TRIANGLES, 1);
 }
 
 void Mesh::draw_Circle()
 {
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLE_FAN, 0, vertexCount);
-    glBindVertexArray(0);
+    submit(GL_TRIANGLE_FAN, 1);
 }
 
 void Mesh::draw_Lines()
 {
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_LINES, 0, vertexCount);
-    glBindVertexArray(0);
+    submit(GL_LINES, 1);
+}
+
+void Mesh::drawInstanced(GLenum mode)
+{
+    if (instanceCount > 0)
+    {
+        submit(mode, instanceCount);
+    }
 }
 
 std::vector<float> Mesh::generateCircleVertices(float radius, int segments)
@@ -101,46 +221,3 @@ glm::vec4 Mesh::getColor()
 {
     return color;
 }
-
-std::vector<float> Mesh::generateGridVertices(float size, int divisions)
-{
-    std::vector<float> vertices;
-
-    // Create a grid of lines in the XY plane (Z=0)
-    // Lines go in both X and Y directions
-    float step = size / divisions;
-    float halfSize = size / 2.0f;
-
-    // Horizontal lines (along X axis)
-    for (int i = 0; i <= divisions; ++i)
-    {
-        float y = -halfSize + i * step;
-
-        // Line from (-halfSize, y, 0) to (halfSize, y, 0)
-        vertices.push_back(-halfSize);  // x
-        vertices.push_back(y);          // y
-        vertices.push_back(0.0f);       // z
-
-        vertices.push_back(halfSize);   // x
-        vertices.push_back(y);          // y
-        vertices.push_back(0.0f);       // z
-    }
-
-    // Vertical lines (along Y axis)
-    for (int i = 0; i <= divisions; ++i)
-    {
-        float x = -halfSize + i * step;
-
-        // Line from (x, -halfSize, 0) to (x, halfSize, 0)
-        vertices.push_back(x);          // x
-        vertices.push_back(-halfSize);  // y
-        vertices.push_back(0.0f);       // z
-
-        vertices.push_back(x);          // x
-        vertices.push_back(halfSize);   // y
-        vertices.push_back(0.0f);       // z
-    }
-
-    return vertices;
-}
-
@@ -0,0 +1,217 @@
+#include <PhotonSystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// storage buffer bindings, must match Shaders/PhotonBuffers.glsl
+static const GLuint photonBinding = 4;
+static const GLuint spawnBinding = 5;
+static const GLuint trailBinding = 6;
+
+// photons.comp local_size_x
+static const GLuint photonGroupSize = 256;
+
+// One element of the Photons block (std430)
+struct GpuPhoton
+{
+	glm::vec4 state;
+	uint32_t head;
+	uint32_t count;
+	uint32_t wait;
+	uint32_t pad;
+};
+static_assert(sizeof(GpuPhoton) == 32, "GpuPhoton has to match struct Photon in PhotonBuffers.glsl");
+
+PhotonSystem::PhotonSystem(size_t photonCount, const BlackHole& blackHole, const PhotonSettings& settings_in)
+	: photonCount(photonCount), settings(settings_in)
+{
+	settings.trailCapacity = std::max<size_t>(settings.trailCapacity, 2);
+
+	//the same fan as the --trails rays, each photon gets its own direction and a random first start
+	std::mt19937 random(settings.seed);
+	std::uniform_int_distribution<uint32_t> wait(0, settings.maxWaitSteps);
+	spawns.reserve(photonCount);
+	waits.reserve(photonCount);
+	for (size_t i = 0; i < photonCount; ++i)
+	{
+		float t = photonCount > 1 ? static_cast<float>(i) / static_cast<float>(photonCount - 1) : 0.5f;
+		float angle = -settings.spreadAngle / 2.0f + settings.spreadAngle * t;
+		glm::vec2 velocity(settings.speed * std::cos(angle), settings.speed * std::sin(angle));
+
+		LightRay ray;
+		ray.initialize(settings.source, velocity, blackHole);
+		spawns.push_back(getRayState(ray));
+		waits.push_back(wait(random));
+	}
+
+	std::vector<glm::vec4> spawnData(photonCount);
+	for (size_t i = 0; i < photonCount; ++i)
+	{
+		spawnData[i] = glm::vec4(spawns[i].r, spawns[i].theta, spawns[i].dr_dlambda, spawns[i].dtheta_dlambda);
+	}
+
+	//the photons are rewritten by reset(), the spawns never change and the trails only ever live on the GPU
+	glCreateBuffers(1, &photonBuffer);
+	glNamedBufferStorage(photonBuffer, photonCount * sizeof(GpuPhoton), nullptr, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &spawnBuffer);
+	glNamedBufferStorage(spawnBuffer, photonCount * sizeof(glm::vec4), spawnData.data(), 0);
+	glCreateBuffers(1, &trailBuffer);
+	glNamedBufferStorage(trailBuffer, photonCount * settings.trailCapacity * sizeof(glm::vec2), nullptr, 0);
+
+	glCreateVertexArrays(1, &emptyVAO);
+
+	reset();
+}
+
+PhotonSystem::~PhotonSystem()
+{
+	GLuint buffers[] = { photonBuffer, spawnBuffer, trailBuffer };
+	glDeleteBuffers(3, buffers);
+	glDeleteVertexArrays(1, &emptyVAO);
+}
+
+void PhotonSystem::reset()
+{
+	std::vector<GpuPhoton> photons(photonCount);
+	for (size_t i = 0; i < photonCount; ++i)
+	{
+		const RayState& s = spawns[i];
+		photons[i] = GpuPhoton{ glm::vec4(s.r, s.theta, s.dr_dlambda, s.dtheta_dlambda), 0, 0, waits[i], 0 };
+	}
+	glNamedBufferSubData(photonBuffer, 0, photons.size() * sizeof(GpuPhoton), photons.data());
+}
+
+void PhotonSystem::bindBuffers() const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, photonBinding, photonBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, spawnBinding, spawnBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, trailBinding, trailBuffer);
+}
+
+void PhotonSystem::step(Shader& computeShader, float deltaTime, int steps)
+{
+	if (photonCount == 0 || steps <= 0)
+	{
+		return;
+	}
+
+	computeShader.Use();
+	glUniform1ui(computeShader.GetUniformLocation("u_photonCount"), static_cast<GLuint>(photonCount));
+	glUniform1ui(computeShader.GetUniformLocation("u_trailCapacity"), static_cast<GLuint>(settings.trailCapacity));
+	computeShader.SetFloat("u_deltaTime", deltaTime);
+	computeShader.SetFloat("u_escapeRadius", settings.escapeRadius);
+	bindBuffers();
+
+	GLuint groups = static_cast<GLuint>((photonCount + photonGroupSize - 1) / photonGroupSize);
+	for (int i = 0; i < steps; ++i)
+	{
+		//every step reads what the last one (or the last draw) did with the same buffers
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+		glDispatchCompute(groups, 1, 1);
+	}
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void PhotonSystem::draw(Shader& drawShader, const glm::mat4& projection, glm::vec4 color)
+{
+	if (photonCount == 0)
+	{
+		return;
+	}
+
+	drawShader.Use();
+	drawShader.SetMat4("u_Projection", projection);
+	drawShader.SetVec4("u_Color", color);
+	glUniform1ui(drawShader.GetUniformLocation("u_photonCount"), static_cast<GLuint>(photonCount));
+	glUniform1ui(drawShader.GetUniformLocation("u_trailCapacity"), static_cast<GLuint>(settings.trailCapacity));
+	bindBuffers();
+
+	//additive, so where many photons bunch up (around the photon sphere) the picture gets brighter
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(getVertexCount()));
+	glBindVertexArray(0);
+	glDisable(GL_BLEND);
+}
+
+std::vector<glm::vec4> PhotonSystem::readStates() const
+{
+	std::vector<GpuPhoton> photons(photonCount);
+	glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+	glGetNamedBufferSubData(photonBuffer, 0, photons.size() * sizeof(GpuPhoton), photons.data());
+
+	std::vector<glm::vec4> states(photonCount);
+	for (size_t i = 0; i < photonCount; ++i)
+	{
+		states[i] = photons[i].state;
+	}
+	return states;
+}
+
+PhotonCheck PhotonSystem::checkAgainstCpu(Shader& computeShader, const BlackHole& blackHole, float deltaTime, int steps,
+	size_t sampleStride, float tolerance)
+{
+	reset();
+	step(computeShader, deltaTime, steps);
+	std::vector<glm::vec4> gpuStates = readStates();
+	reset();
+
+	float Rs = static_cast<float>(blackHole.schwarzschildRadius);
+	PhotonCheck check;
+	for (size_t i = 0; i < photonCount; i += std::max<size_t>(sampleStride, 1))
+	{
+		//same steps as photons.comp: wait, then step and start over when it falls in or leaves
+		RayState s = spawns[i];
+		for (int n = static_cast<int>(waits[i]); n < steps; ++n)
+		{
+			s = rk4Step(s, deltaTime, Rs);
+			if (!(s.r > Rs) || s.r > settings.escapeRadius)
+			{
+				s = spawns[i];
+			}
+		}
+
+		float difference = std::abs(gpuStates[i].x - s.r) / std::max(s.r, Rs);
+		++check.checked;
+		if (difference <= tolerance)
+		{
+			++check.agreeing;
+			check.maxDifference = std::max(check.maxDifference, difference);
+		}
+	}
+	return check;
+}
+
+const std::vector<RayState>& PhotonSystem::getSpawns() const
+{
+	return spawns;
+}
+
+const std::vector<uint32_t>& PhotonSystem::getWaits() const
+{
+	return waits;
+}
+
+size_t PhotonSystem::getPhotonCount() const
+{
+	return photonCount;
+}
+
+size_t PhotonSystem::getVertexCount() const
+{
+	return photonCount * (settings.trailCapacity - 1) * 2;
+}
+
+size_t PhotonSystem::memoryBytes() const
+{
+	return photonCount * (sizeof(GpuPhoton) + sizeof(glm::vec4) + settings.trailCapacity * sizeof(glm::vec2));
+}
+
+bool PhotonSystem::isSupported()
+{
+	GLint vertexBlocks = 0;
+	glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &vertexBlocks);
+	return vertexBlocks >= 3;
+}
@@ -0,0 +1,251 @@
+#include <Profiler.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Weight of the newest frame in the rolling averages
+static const double summaryBlend = 0.05;
+
+Profiler::Profiler(bool gpuTimers, int frameLatency, int maxZonesPerFrame)
+	: gpuTimers(gpuTimers), maxZonesPerFrame(maxZonesPerFrame)
+{
+	slots.resize(frameLatency > 0 ? frameLatency : 1);
+	for (FrameSlot& slot : slots)
+	{
+		slot.zones.reserve(maxZonesPerFrame);
+		if (gpuTimers)
+		{
+			slot.queries.resize(2 * static_cast<size_t>(maxZonesPerFrame));
+			glGenQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+		}
+	}
+	openZones.reserve(maxZonesPerFrame);
+}
+
+Profiler::~Profiler()
+{
+	for (FrameSlot& slot : slots)
+	{
+		if (!slot.queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+		}
+	}
+}
+
+void Profiler::beginFrame()
+{
+	// This slot was used frameLatency frames ago, its GPU results should be in by now
+	FrameSlot& slot = slots[currentSlot];
+	collect(slot, false);
+
+	slot.frame = frameIndex;
+	slot.zones.clear();
+	slot.usedPairs = 0;
+	openZones.clear();
+
+	beginZone("frame");
+}
+
+void Profiler::endFrame()
+{
+	// close anything left open, then the frame zone itself
+	while (!openZones.empty())
+	{
+		endZone();
+	}
+
+	FrameSlot& slot = slots[currentSlot];
+	slot.pending = true;
+	if (!gpuTimers)
+	{
+		collect(slot, false); // nothing to wait for
+	}
+
+	currentSlot = (currentSlot + 1) % static_cast<int>(slots.size());
+	frameIndex++;
+}
+
+void Profiler::beginZone(const char* name)
+{
+	FrameSlot& slot = slots[currentSlot];
+
+	PendingZone zone;
+	zone.name = name;
+	zone.depth = static_cast<int>(openZones.size());
+	zone.cpuMs = 0.0;
+	zone.queryPair = -1;
+	if (gpuTimers && slot.usedPairs < maxZonesPerFrame)
+	{
+		zone.queryPair = slot.usedPairs++;
+		glQueryCounter(slot.queries[2 * zone.queryPair], GL_TIMESTAMP);
+	}
+
+	openZones.push_back(static_cast<int>(slot.zones.size()));
+	slot.zones.push_back(zone);
+	slot.zones.back().cpuBegin = Clock::now();
+}
+
+void Profiler::endZone()
+{
+	if (openZones.empty())
+	{
+		std::cerr << "ERROR: Profiler::endZone without a matching beginZone" << std::endl;
+		return;
+	}
+
+	FrameSlot& slot = slots[currentSlot];
+	PendingZone& zone = slot.zones[openZones.back()];
+	openZones.pop_back();
+
+	zone.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - zone.cpuBegin).count();
+	if (zone.queryPair >= 0)
+	{
+		glQueryCounter(slot.queries[2 * zone.queryPair + 1], GL_TIMESTAMP);
+	}
+}
+
+void Profiler::collect(FrameSlot& slot, bool wait)
+{
+	if (!slot.pending)
+	{
+		return;
+	}
+	slot.pending = false;
+
+	if (gpuTimers && slot.usedPairs > 0 && !wait)
+	{
+		// the frame zone (pair 0) ends after every other zone, if its end is ready they all are
+		GLint available = 0;
+		glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			droppedFrames++;
+			return;
+		}
+	}
+
+	for (const PendingZone& zone : slot.zones)
+	{
+		ProfileRecord record{ slot.frame, zone.name, zone.depth, zone.cpuMs, -1.0 };
+		if (zone.queryPair >= 0)
+		{
+			GLuint64 begin = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(slot.queries[2 * zone.queryPair], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(slot.queries[2 * zone.queryPair + 1], GL_QUERY_RESULT, &end);
+			record.gpuMs = static_cast<double>(end - begin) / 1.0e6;  // nanoseconds
+		}
+		records.push_back(record);
+		addToSummary(record);
+	}
+}
+
+void Profiler::flush()
+{
+	// oldest first, so the records stay in frame order
+	for (size_t i = 0; i < slots.size(); ++i)
+	{
+		collect(slots[(currentSlot + i) % slots.size()], true);
+	}
+}
+
+void Profiler::addToSummary(const ProfileRecord& record)
+{
+	for (ProfileSummary& entry : summary)
+	{
+		if (entry.depth == record.depth && std::strcmp(entry.name, record.name) == 0)
+		{
+			entry.cpuMs += (record.cpuMs - entry.cpuMs) * summaryBlend;
+			entry.gpuMs += (record.gpuMs - entry.gpuMs) * summaryBlend;
+			return;
+		}
+	}
+	summary.push_back(ProfileSummary{ record.name, record.depth, record.cpuMs, record.gpuMs });
+}
+
+const std::vector<ProfileRecord>& Profiler::getRecords() const
+{
+	return records;
+}
+
+const std::vector<ProfileSummary>& Profiler::getSummary() const
+{
+	return summary;
+}
+
+uint64_t Profiler::getDroppedFrames() const
+{
+	return droppedFrames;
+}
+
+std::string Profiler::summaryText() const
+{
+	std::string text;
+	char buffer[128];
+	for (const ProfileSummary& entry : summary)
+	{
+		if (!text.empty())
+		{
+			text += " | ";
+		}
+		if (entry.gpuMs >= 0.0)
+		{
+			std::snprintf(buffer, sizeof(buffer), "%s %.2f ms (gpu %.2f)", entry.name, entry.cpuMs, entry.gpuMs);
+		}
+		else
+		{
+			std::snprintf(buffer, sizeof(buffer), "%s %.2f ms", entry.name, entry.cpuMs);
+		}
+		text += buffer;
+	}
+	return text;
+}
+
+bool Profiler::writeFile(const std::string& filePath) const
+{
+	bool json = filePath.size() >= 5 && filePath.compare(filePath.size() - 5, 5, ".json") == 0;
+	return json ? writeJSON(filePath) : writeCSV(filePath);
+}
+
+bool Profiler::writeCSV(const std::string& filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open profile output: " << filePath << std::endl;
+		return false;
+	}
+
+	file << "frame,zone,depth,cpu_ms,gpu_ms\n";
+	for (const ProfileRecord& record : records)
+	{
+		file << record.frame << "," << record.name << "," << record.depth << ","
+		     << record.cpuMs << "," << record.gpuMs << "\n";
+	}
+	return file.good();
+}
+
+bool Profiler::writeJSON(const std::string& filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		std::cerr << "ERROR: Could not open profile output: " << filePath << std::endl;
+		return false;
+	}
+
+	// zone names are string literals from our own code, no escaping needed
+	file << "{\n  \"droppedFrames\": " << droppedFrames << ",\n  \"records\": [\n";
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const ProfileRecord& record = records[i];
+		file << "    {\"frame\": " << record.frame << ", \"zone\": \"" << record.name << "\", \"depth\": " << record.depth
+		     << ", \"cpuMs\": " << record.cpuMs << ", \"gpuMs\": " << record.gpuMs << "}"
+		     << (i + 1 < records.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n}\n";
+	return file.good();
+}
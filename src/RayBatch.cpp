@@ -0,0 +1,242 @@
+#include <RayBatch.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+static const uint32_t laneAlive = 0xFFFFFFFFu;
+
+//check what the CPU (and the OS, for the wide registers) supports
+static SimdLevel queryCpu()
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return SimdLevel::Scalar;
+    }
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx)
+    {
+        return SimdLevel::Scalar;
+    }
+
+    // OS has to save the YMM (and for AVX-512 the ZMM/opmask) registers
+    unsigned long long xcr0 = _xgetbv(0);
+    bool ymmEnabled = (xcr0 & 0x6) == 0x6;
+    bool zmmEnabled = (xcr0 & 0xE6) == 0xE6;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx512f && zmmEnabled)
+    {
+        return SimdLevel::AVX512;
+    }
+    if (avx2 && ymmEnabled)
+    {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::Scalar;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    return SimdLevel::Scalar;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel detectSimdLevel()
+{
+    static const SimdLevel level = queryCpu();
+    return level;
+}
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX512: return "AVX-512";
+    case SimdLevel::AVX2:   return "AVX2";
+    default:                return "Scalar";
+    }
+}
+
+void stepRayBatchScalar(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        if (!lanes.active[i])
+        {
+            continue;
+        }
+
+        RayState state{ lanes.r[i], lanes.theta[i], lanes.dr_dlambda[i], lanes.dtheta_dlambda[i] };
+        state = rk4Step(state, deltaTime, Rs);
+
+        lanes.r[i] = state.r;
+        lanes.theta[i] = state.theta;
+        lanes.dr_dlambda[i] = state.dr_dlambda;
+        lanes.dtheta_dlambda[i] = state.dtheta_dlambda;
+
+        // Event horizon check (same as LightRay::step)
+        if (state.r <= Rs)
+        {
+            lanes.active[i] = 0;
+        }
+    }
+}
+
+RayBatch::RayBatch(size_t capacity)
+{
+    reserve(capacity);
+}
+
+void RayBatch::reserve(size_t capacity)
+{
+    size_t padded = (capacity + laneWidth - 1) / laneWidth * laneWidth;
+    r.reserve(padded);
+    theta.reserve(padded);
+    dr_dlambda.reserve(padded);
+    dtheta_dlambda.reserve(padded);
+    active.reserve(padded);
+}
+
+void RayBatch::clear()
+{
+    count = 0;
+    resizeLanes(0);
+}
+
+size_t RayBatch::size() const
+{
+    return count;
+}
+
+void RayBatch::resizeLanes(size_t paddedCount)
+{
+    //padding lanes are inactive so the kernels never touch them
+    r.resize(paddedCount, 1.0f);
+    theta.resize(paddedCount, 0.0f);
+    dr_dlambda.resize(paddedCount, 0.0f);
+    dtheta_dlambda.resize(paddedCount, 0.0f);
+    active.resize(paddedCount, 0);
+}
+
+size_t RayBatch::addRay(glm::vec2 startPos, glm::vec2 startVel, const BlackHole& blackHole)
+{
+    LightRay ray;
+    ray.initialize(startPos, startVel, blackHole);
+    return addRay(ray);
+}
+
+size_t RayBatch::addRay(const LightRay& ray)
+{
+    size_t index = count++;
+    if (index >= r.size())
+    {
+        resizeLanes(r.size() + laneWidth);
+    }
+
+    r[index] = ray.r;
+    theta[index] = ray.theta;
+    dr_dlambda[index] = ray.dr_dlambda;
+    dtheta_dlambda[index] = ray.dtheta_dlambda;
+    active[index] = ray.active ? laneAlive : 0;
+    return index;
+}
+
+void RayBatch::step(float deltaTime, const BlackHole& blackHole)
+{
+    step(deltaTime, blackHole, detectSimdLevel());
+}
+
+void RayBatch::step(float deltaTime, const BlackHole& blackHole, SimdLevel level)
+{
+    stepRange(0, r.size(), deltaTime, blackHole, level);
+}
+
+void RayBatch::step(float deltaTime, const BlackHole& blackHole, ThreadPool& pool, size_t raysPerChunk)
+{
+    //chunks start on a lane boundary so the SIMD kernels never share a register's worth of rays
+    size_t chunkSize = std::max<size_t>(1, (raysPerChunk + laneWidth - 1) / laneWidth) * laneWidth;
+    SimdLevel level = detectSimdLevel();
+    pool.parallelForRange(r.size(), chunkSize, [&](size_t begin, size_t end, unsigned)
+    {
+        stepRange(begin, end, deltaTime, blackHole, level);
+    });
+}
+
+void RayBatch::stepRange(size_t begin, size_t end, float deltaTime, const BlackHole& blackHole, SimdLevel level)
+{
+    end = std::min(end, r.size());
+    if (begin >= end)
+    {
+        return;
+    }
+
+    //never run a kernel the CPU can't execute
+    if (level > detectSimdLevel())
+    {
+        level = detectSimdLevel();
+    }
+
+    float Rs = static_cast<float>(blackHole.schwarzschildRadius);
+    RayBatchLanes view = lanes();
+
+    switch (level)
+    {
+    case SimdLevel::AVX512:
+        stepRayBatchAVX512(view, begin, end, deltaTime, Rs);
+        break;
+    case SimdLevel::AVX2:
+        stepRayBatchAVX2(view, begin, end, deltaTime, Rs);
+        break;
+    default:
+        stepRayBatchScalar(view, begin, end, deltaTime, Rs);
+        break;
+    }
+}
+
+bool RayBatch::isActive(size_t index) const
+{
+    return active[index] != 0;
+}
+
+size_t RayBatch::countActive() const
+{
+    return static_cast<size_t>(std::count_if(active.begin(), active.begin() + count,
+        [](uint32_t lane) { return lane != 0; }));
+}
+
+RayState RayBatch::getState(size_t index) const
+{
+    return RayState{ r[index], theta[index], dr_dlambda[index], dtheta_dlambda[index] };
+}
+
+glm::vec2 RayBatch::getPosition(size_t index, const BlackHole& blackHole) const
+{
+    return polarToCartesian(r[index], theta[index], blackHole.position);
+}
+
+RayBatchLanes RayBatch::lanes()
+{
+    return RayBatchLanes{ r.data(), theta.data(), dr_dlambda.data(), dtheta_dlambda.data(), active.data() };
+}
@@ -0,0 +1,109 @@
+#include <RayBatch.hpp>
+
+//this file is built with AVX2 enabled (-mavx2 or /arch:AVX2, see CmakeLists.txt).
+//it is only called when detectSimdLevel() says the CPU supports it.
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+namespace
+{
+    struct Lanes8
+    {
+        __m256 r, theta, dr, dtheta;
+    };
+
+    // Geodesic derivatives for 8 rays, same operation order as calculateDerivatives()
+    // so the results match the scalar kernel bit for bit
+    inline Lanes8 derivatives(const Lanes8& s, __m256 negC2Rs, __m256 two)
+    {
+        __m256 r2 = _mm256_mul_ps(_mm256_mul_ps(two, s.r), s.r);
+        __m256 centrifugal = _mm256_mul_ps(_mm256_mul_ps(s.r, s.dtheta), s.dtheta);
+        __m256 d2r = _mm256_add_ps(_mm256_div_ps(negC2Rs, r2), centrifugal);
+
+        __m256 negTwoOverR = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_div_ps(two, s.r));
+        __m256 d2theta = _mm256_mul_ps(_mm256_mul_ps(negTwoOverR, s.dr), s.dtheta);
+
+        return Lanes8{ s.dr, s.dtheta, d2r, d2theta };
+    }
+
+    // s + k * scale
+    inline Lanes8 addScaled(const Lanes8& s, const Lanes8& k, __m256 scale)
+    {
+        return Lanes8{
+            _mm256_add_ps(s.r, _mm256_mul_ps(k.r, scale)),
+            _mm256_add_ps(s.theta, _mm256_mul_ps(k.theta, scale)),
+            _mm256_add_ps(s.dr, _mm256_mul_ps(k.dr, scale)),
+            _mm256_add_ps(s.dtheta, _mm256_mul_ps(k.dtheta, scale))
+        };
+    }
+
+    // k1 + (k2*2 + (k3*2 + k4)) for one component
+    inline __m256 combine(__m256 k1, __m256 k2, __m256 k3, __m256 k4, __m256 two)
+    {
+        return _mm256_add_ps(k1, _mm256_add_ps(_mm256_mul_ps(k2, two), _mm256_add_ps(_mm256_mul_ps(k3, two), k4)));
+    }
+}
+
+void stepRayBatchAVX2(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs)
+{
+    const float c = static_cast<float>(C);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 negC2Rs = _mm256_set1_ps(-(c * c * Rs));
+    const __m256 halfStep = _mm256_set1_ps(deltaTime / 2.0f);
+    const __m256 fullStep = _mm256_set1_ps(deltaTime);
+    const __m256 sixthStep = _mm256_set1_ps(deltaTime / 6.0f);
+    const __m256 horizon = _mm256_set1_ps(Rs);
+
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 alive = _mm256_castsi256_ps(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes.active + i)));
+        if (_mm256_movemask_ps(alive) == 0)
+        {
+            continue; //all 8 rays already fell in
+        }
+
+        Lanes8 initial{
+            _mm256_loadu_ps(lanes.r + i),
+            _mm256_loadu_ps(lanes.theta + i),
+            _mm256_loadu_ps(lanes.dr_dlambda + i),
+            _mm256_loadu_ps(lanes.dtheta_dlambda + i)
+        };
+
+        Lanes8 k1 = derivatives(initial, negC2Rs, two);
+        Lanes8 k2 = derivatives(addScaled(initial, k1, halfStep), negC2Rs, two);
+        Lanes8 k3 = derivatives(addScaled(initial, k2, halfStep), negC2Rs, two);
+        Lanes8 k4 = derivatives(addScaled(initial, k3, fullStep), negC2Rs, two);
+
+        Lanes8 sum{
+            combine(k1.r, k2.r, k3.r, k4.r, two),
+            combine(k1.theta, k2.theta, k3.theta, k4.theta, two),
+            combine(k1.dr, k2.dr, k3.dr, k4.dr, two),
+            combine(k1.dtheta, k2.dtheta, k3.dtheta, k4.dtheta, two)
+        };
+        Lanes8 next = addScaled(initial, sum, sixthStep);
+
+        // Only write lanes that were still active
+        _mm256_storeu_ps(lanes.r + i, _mm256_blendv_ps(initial.r, next.r, alive));
+        _mm256_storeu_ps(lanes.theta + i, _mm256_blendv_ps(initial.theta, next.theta, alive));
+        _mm256_storeu_ps(lanes.dr_dlambda + i, _mm256_blendv_ps(initial.dr, next.dr, alive));
+        _mm256_storeu_ps(lanes.dtheta_dlambda + i, _mm256_blendv_ps(initial.dtheta, next.dtheta, alive));
+
+        // Event horizon check: stay alive only while !(r <= Rs)
+        __m256 outside = _mm256_cmp_ps(next.r, horizon, _CMP_NLE_UQ);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes.active + i), _mm256_castps_si256(_mm256_and_ps(alive, outside)));
+    }
+
+    //leftover rays (range not a multiple of 8)
+    stepRayBatchScalar(lanes, i, end, deltaTime, Rs);
+}
+
+#else
+
+//compiler can't target AVX2 here, detectSimdLevel never picks it but keep the symbol
+void stepRayBatchAVX2(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs)
+{
+    stepRayBatchScalar(lanes, begin, end, deltaTime, Rs);
+}
+
+#endif
@@ -0,0 +1,110 @@
+#include <RayBatch.hpp>
+
+//this file is built with AVX-512F enabled (-mavx512f or /arch:AVX512, see CmakeLists.txt).
+//it is only called when detectSimdLevel() says the CPU supports it.
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+namespace
+{
+    struct Lanes16
+    {
+        __m512 r, theta, dr, dtheta;
+    };
+
+    // Geodesic derivatives for 16 rays, same operation order as calculateDerivatives()
+    inline Lanes16 derivatives(const Lanes16& s, __m512 negC2Rs, __m512 two)
+    {
+        __m512 r2 = _mm512_mul_ps(_mm512_mul_ps(two, s.r), s.r);
+        __m512 centrifugal = _mm512_mul_ps(_mm512_mul_ps(s.r, s.dtheta), s.dtheta);
+        __m512 d2r = _mm512_add_ps(_mm512_div_ps(negC2Rs, r2), centrifugal);
+
+        __m512 negTwoOverR = _mm512_sub_ps(_mm512_setzero_ps(), _mm512_div_ps(two, s.r));
+        __m512 d2theta = _mm512_mul_ps(_mm512_mul_ps(negTwoOverR, s.dr), s.dtheta);
+
+        return Lanes16{ s.dr, s.dtheta, d2r, d2theta };
+    }
+
+    // s + k * scale
+    inline Lanes16 addScaled(const Lanes16& s, const Lanes16& k, __m512 scale)
+    {
+        return Lanes16{
+            _mm512_add_ps(s.r, _mm512_mul_ps(k.r, scale)),
+            _mm512_add_ps(s.theta, _mm512_mul_ps(k.theta, scale)),
+            _mm512_add_ps(s.dr, _mm512_mul_ps(k.dr, scale)),
+            _mm512_add_ps(s.dtheta, _mm512_mul_ps(k.dtheta, scale))
+        };
+    }
+
+    // k1 + (k2*2 + (k3*2 + k4)) for one component
+    inline __m512 combine(__m512 k1, __m512 k2, __m512 k3, __m512 k4, __m512 two)
+    {
+        return _mm512_add_ps(k1, _mm512_add_ps(_mm512_mul_ps(k2, two), _mm512_add_ps(_mm512_mul_ps(k3, two), k4)));
+    }
+}
+
+void stepRayBatchAVX512(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs)
+{
+    const float c = static_cast<float>(C);
+    const __m512 two = _mm512_set1_ps(2.0f);
+    const __m512 negC2Rs = _mm512_set1_ps(-(c * c * Rs));
+    const __m512 halfStep = _mm512_set1_ps(deltaTime / 2.0f);
+    const __m512 fullStep = _mm512_set1_ps(deltaTime);
+    const __m512 sixthStep = _mm512_set1_ps(deltaTime / 6.0f);
+    const __m512 horizon = _mm512_set1_ps(Rs);
+    const __m512i allBits = _mm512_set1_epi32(-1);
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16)
+    {
+        __m512i activeBits = _mm512_loadu_si512(lanes.active + i);
+        __mmask16 alive = _mm512_test_epi32_mask(activeBits, activeBits);
+        if (alive == 0)
+        {
+            continue; //all 16 rays already fell in
+        }
+
+        Lanes16 initial{
+            _mm512_loadu_ps(lanes.r + i),
+            _mm512_loadu_ps(lanes.theta + i),
+            _mm512_loadu_ps(lanes.dr_dlambda + i),
+            _mm512_loadu_ps(lanes.dtheta_dlambda + i)
+        };
+
+        Lanes16 k1 = derivatives(initial, negC2Rs, two);
+        Lanes16 k2 = derivatives(addScaled(initial, k1, halfStep), negC2Rs, two);
+        Lanes16 k3 = derivatives(addScaled(initial, k2, halfStep), negC2Rs, two);
+        Lanes16 k4 = derivatives(addScaled(initial, k3, fullStep), negC2Rs, two);
+
+        Lanes16 sum{
+            combine(k1.r, k2.r, k3.r, k4.r, two),
+            combine(k1.theta, k2.theta, k3.theta, k4.theta, two),
+            combine(k1.dr, k2.dr, k3.dr, k4.dr, two),
+            combine(k1.dtheta, k2.dtheta, k3.dtheta, k4.dtheta, two)
+        };
+        Lanes16 next = addScaled(initial, sum, sixthStep);
+
+        // Masked stores: lanes that already fell in are left alone
+        _mm512_mask_storeu_ps(lanes.r + i, alive, next.r);
+        _mm512_mask_storeu_ps(lanes.theta + i, alive, next.theta);
+        _mm512_mask_storeu_ps(lanes.dr_dlambda + i, alive, next.dr);
+        _mm512_mask_storeu_ps(lanes.dtheta_dlambda + i, alive, next.dtheta);
+
+        // Event horizon check: stay alive only while !(r <= Rs)
+        __mmask16 outside = _mm512_mask_cmp_ps_mask(alive, next.r, horizon, _CMP_NLE_UQ);
+        _mm512_storeu_si512(lanes.active + i, _mm512_maskz_mov_epi32(outside, allBits));
+    }
+
+    //leftover rays (range not a multiple of 16)
+    stepRayBatchScalar(lanes, i, end, deltaTime, Rs);
+}
+
+#else
+
+//compiler can't target AVX-512 here, detectSimdLevel never picks it but keep the symbol
+void stepRayBatchAVX512(const RayBatchLanes& lanes, size_t begin, size_t end, float deltaTime, float Rs)
+{
+    stepRayBatchScalar(lanes, begin, end, deltaTime, Rs);
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include <RaySimulation.hpp>
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+//if the thread is this many steps behind the clock (the machine stalled, a debugger stopped it ...)
+//the extra steps are skipped instead of run back to back, so it doesn't keep falling further behind
+static const uint64_t maxCatchUpSteps = 8;
+
+//every slot is sized up front, after that publishing a snapshot never allocates
+static RaySnapshot emptySnapshot(size_t rayCount)
+{
+	RaySnapshot snapshot;
+	snapshot.positions.resize(rayCount);
+	snapshot.active.resize(rayCount);
+	return snapshot;
+}
+
+RaySimulation::RaySimulation(RayBatch rays_in, const BlackHole& blackHole, double stepSeconds, unsigned threadCount)
+	: rays(std::move(rays_in)), blackHole(blackHole), stepSeconds(stepSeconds),
+	snapshots(emptySnapshot(rays.size())), previous(emptySnapshot(rays.size()))
+{
+	if (threadCount != 1)
+	{
+		pool = std::make_unique<ThreadPool>(threadCount);
+	}
+}
+
+RaySimulation::~RaySimulation()
+{
+	stop();
+}
+
+void RaySimulation::start()
+{
+	if (running.exchange(true))
+	{
+		return;
+	}
+	thread = std::thread(&RaySimulation::run, this);
+}
+
+void RaySimulation::stop()
+{
+	running = false;
+	if (thread.joinable())
+	{
+		thread.join();
+	}
+}
+
+double RaySimulation::clockSeconds()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void RaySimulation::takeSnapshot(RaySnapshot& snapshot, uint64_t tick, double time) const
+{
+	snapshot.tick = tick;
+	snapshot.time = time;
+	size_t count = std::min(rays.size(), snapshot.positions.size());
+	for (size_t i = 0; i < count; ++i)
+	{
+		snapshot.positions[i] = rays.getPosition(i, blackHole);
+		snapshot.active[i] = rays.isActive(i) ? 1 : 0;
+	}
+}
+
+void RaySimulation::run()
+{
+	//step k belongs to time origin + k * stepSeconds on the clock
+	double origin = clockSeconds();
+	uint64_t tick = 0;
+
+	takeSnapshot(snapshots.writeBuffer(), tick, origin);
+	snapshots.publish();
+
+	while (running.load(std::memory_order_relaxed))
+	{
+		uint64_t due = static_cast<uint64_t>((clockSeconds() - origin) / stepSeconds);
+		if (due > tick + maxCatchUpSteps)
+		{
+			uint64_t skipped = due - tick - maxCatchUpSteps;
+			origin += static_cast<double>(skipped) * stepSeconds;
+			due -= skipped;
+			droppedTicks.fetch_add(skipped, std::memory_order_relaxed);
+		}
+
+		while (tick < due && running.load(std::memory_order_relaxed))
+		{
+			if (pool)
+			{
+				rays.step(static_cast<float>(stepSeconds), blackHole, *pool);
+			}
+			else
+			{
+				rays.step(static_cast<float>(stepSeconds), blackHole);
+			}
+			++tick;
+			takeSnapshot(snapshots.writeBuffer(), tick, origin + static_cast<double>(tick) * stepSeconds);
+			snapshots.publish();
+			ticks.store(tick, std::memory_order_relaxed);
+		}
+
+		//sleep until the next step is due
+		double wakeTime = origin + static_cast<double>(tick + 1) * stepSeconds;
+		std::this_thread::sleep_for(std::chrono::duration<double>(std::max(0.0, wakeTime - clockSeconds())));
+	}
+}
+
+bool RaySimulation::sample(std::vector<glm::vec2>& positions, std::vector<uint8_t>& active)
+{
+	if (snapshots.hasUpdate())
+	{
+		//keep the one we have as the start of the blend, the front slot goes back to the writer on update().
+		//swapping hands the writer previous's vectors instead, they're the same size and it overwrites
+		//every element, so this stays O(1) however many rays there are
+		if (hasSnapshot)
+		{
+			std::swap(previous, snapshots.readBuffer());
+		}
+		snapshots.update();
+		if (!hasSnapshot)
+		{
+			previous = snapshots.readBuffer();  // once, the first snapshot blends with itself
+			hasSnapshot = true;
+		}
+	}
+	if (!hasSnapshot)
+	{
+		return false;
+	}
+
+	//draw one step behind the clock, so there is (almost) always a newer snapshot to blend towards
+	const RaySnapshot& current = snapshots.readBuffer();
+	double renderTime = clockSeconds() - stepSeconds;
+	double span = current.time - previous.time;
+	float alpha = 1.0f;
+	if (span > 0.0)
+	{
+		alpha = static_cast<float>(std::clamp((renderTime - previous.time) / span, 0.0, 1.0));
+	}
+
+	size_t count = current.positions.size();
+	positions.resize(count);
+	active.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		positions[i] = glm::mix(previous.positions[i], current.positions[i], alpha);
+		active[i] = current.active[i];
+	}
+	return true;
+}
+
+size_t RaySimulation::size() const
+{
+	return rays.size();
+}
+
+double RaySimulation::getStepSeconds() const
+{
+	return stepSeconds;
+}
+
+uint64_t RaySimulation::getTicks() const
+{
+	return ticks.load(std::memory_order_relaxed);
+}
+
+uint64_t RaySimulation::getDroppedTicks() const
+{
+	return droppedTicks.load(std::memory_order_relaxed);
+}
@@ -1,46 +1,183 @@
 #include <Shader.hpp>
+#include <EmbeddedShaders.hpp>
+#include <FrameParams.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 
-Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode)
-{
-	// Convert from std::string to const char*
-	const char* vertexShaderCode = vertexCode.c_str();
-	const char* fragmentShaderCode = fragmentCode.c_str();
+// ------------------------------
+// Build settings shared by every program
+// ------------------------------
 
-	int success{};
-	char infoLog[1024]{};
+// "" = use the sources built into the executable
+static std::string sourceDirectory;
+// "" = no program binary cache
+static std::string programCacheDirectory;
+static bool parallelCompile = false;
 
-	// Vertex Shader
-	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	// Specify source code for shader before compiling it
-	glShaderSource(vertexShader, 1, &vertexShaderCode, nullptr);
-	glCompileShader(vertexShader);
+// Start of every cache file: magic, binary format, length (the binary follows)
+struct ProgramCacheHeader
+{
+	char magic[4];
+	uint32_t binaryFormat;
+	uint32_t length;
+};
+static const char programCacheMagic[4] = { 'B', 'H', 'P', 'B' };
 
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertexShader, 1024, nullptr, infoLog);
-		std::cerr << "Failed to compile vertex shader!" << std::endl;
-		std::cerr << "InfoLog: " << infoLog << std::endl;
+//64 bit FNV-1a, good enough to tell sources and drivers apart
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
 	}
+	return hash;
+}
 
-	// Fragment Shader
-	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	// Specify source code for shader before compiling it
-	glShaderSource(fragmentShader, 1, &fragmentShaderCode, nullptr);
-	glCompileShader(fragmentShader);
+static const char* stageName(GLenum type)
+{
+	switch (type)
+	{
+	case GL_VERTEX_SHADER:   return "vertex";
+	case GL_FRAGMENT_SHADER: return "fragment";
+	case GL_COMPUTE_SHADER:  return "compute";
+	default:                 return "unknown";
+	}
+}
 
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragmentShader, 1024, nullptr, infoLog);
-		std::cerr << "Failed to compile fragment shader!" << std::endl;
-		std::cerr << "InfoLog: " << infoLog << std::endl;
+Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	startBuild({ { GL_VERTEX_SHADER, vertexCode }, { GL_FRAGMENT_SHADER, fragmentCode } });
+	Finish();
+}
+
+Shader::Shader(const std::string& computeCode, bool isCompute)
+{
+	if(!isCompute)
+	{
+		std::cerr << "ERROR: Use the other constructor for non-compute shaders." << std::endl;
+		return;
 	}
+	startBuild({ { GL_COMPUTE_SHADER, computeCode } });
+	Finish();
+}
 
+Shader::Shader(const std::vector<ShaderStage>& stages)
+{
+	startBuild(stages);
+}
 
-	// Take both shaders and combine them to form a Shader Program, assign to private member variable
+void Shader::startBuild(const std::vector<ShaderStage>& stages)
+{
+	pendingStages = stages;
+	pending = true;
 	shaderProgramID = glCreateProgram();
-	glAttachShader(shaderProgramID, vertexShader);
-	glAttachShader(shaderProgramID, fragmentShader);
+
+	if (!programCacheDirectory.empty())
+	{
+		// key = driver + every stage, a new driver or an edited shader gives a new file name
+		uint64_t hash = 14695981039346656037ull;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const GLubyte* value = glGetString(name);
+			const char* text = value ? reinterpret_cast<const char*>(value) : "";
+			hash = hashBytes(hash, text, std::strlen(text) + 1);
+		}
+		for (const ShaderStage& stage : stages)
+		{
+			hash = hashBytes(hash, &stage.type, sizeof(stage.type));
+			hash = hashBytes(hash, stage.code.data(), stage.code.size());
+		}
+
+		char key[17];
+		std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+		cacheKey = key;
+
+		if (loadCachedBinary())
+		{
+			fromCache = true;
+			return; // link status is checked in Finish(), a refused binary gets compiled there
+		}
+	}
+
+	compileAndLink();
+}
+
+void Shader::compileAndLink()
+{
+	//only hand the work to the driver here. nothing asks for a status until Finish(),
+	//so with parallel compile the driver is free to do it in the background.
+	for (const ShaderStage& stage : pendingStages)
+	{
+		const char* code = stage.code.c_str();
+		GLuint shader = glCreateShader(stage.type);
+		// Specify source code for shader before compiling it
+		glShaderSource(shader, 1, &code, nullptr);
+		glCompileShader(shader);
+		glAttachShader(shaderProgramID, shader);
+		pendingShaders.push_back(shader);
+	}
+
+	if (!cacheKey.empty())
+	{
+		glProgramParameteri(shaderProgramID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(shaderProgramID);
+}
+
+bool Shader::IsBuildDone() const
+{
+	if (!pending || !parallelCompile)
+	{
+		return true;
+	}
+#ifdef GL_KHR_parallel_shader_compile
+	GLint done = GL_TRUE;
+	glGetProgramiv(shaderProgramID, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+#else
+	return true;
+#endif
+}
+
+bool Shader::Finish()
+{
+	if (!pending)
+	{
+		return shaderProgramID != 0;
+	}
+	pending = false;
+
+	int success{};
+	char infoLog[1024]{};
+
+	if (fromCache)
+	{
+		glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &success);
+		if (!success)
+		{
+			// usually a driver that changed without changing its version string, just build it again
+			std::cerr << "Cached program binary was refused, compiling from source" << std::endl;
+			glDeleteProgram(shaderProgramID);
+			shaderProgramID = glCreateProgram();
+			fromCache = false;
+			compileAndLink();
+		}
+	}
+
+	for (size_t i = 0; i < pendingShaders.size(); ++i)
+	{
+		glGetShaderiv(pendingShaders[i], GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(pendingShaders[i], 1024, nullptr, infoLog);
+			std::cerr << "Failed to compile " << stageName(pendingStages[i].type) << " shader!" << std::endl;
+			std::cerr << "InfoLog: " << infoLog << std::endl;
+		}
+	}
 
 	glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &success);
 	if (!success) {
@@ -50,46 +187,151 @@ Shader::Shader(const std::string& vertexCode, const std::string& fragmentCode)
 	}
 
 	// We have linked shaders to the program, can delete shaders now
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
+	for (GLuint shader : pendingShaders)
+	{
+		glDetachShader(shaderProgramID, shader);
+		glDeleteShader(shader);
+	}
+	pendingShaders.clear();
+
+	if (success)
+	{
+		bindFrameParams();
+		if (!fromCache && !cacheKey.empty())
+		{
+			saveCachedBinary();
+		}
+	}
+	pendingStages.clear();
+	return success != 0;
 }
 
-Shader::Shader(const std::string& computeCode, bool isCompute)
+bool Shader::loadCachedBinary()
 {
-	if(!isCompute)
+	std::ifstream file(programCacheDirectory + "/" + cacheKey + ".bin", std::ios::binary);
+	if (!file.is_open())
+	{
+		return false; // not built on this driver yet
+	}
+
+	ProgramCacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || std::memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) != 0 || header.length == 0)
+	{
+		return false;
+	}
+
+	std::vector<char> binary(header.length);
+	file.read(binary.data(), binary.size());
+	if (!file)
+	{
+		return false;
+	}
+
+	glProgramBinary(shaderProgramID, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+	return true;
+}
+
+void Shader::saveCachedBinary() const
+{
+	GLint length = 0;
+	glGetProgramiv(shaderProgramID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
 	{
-		std::cerr << "ERROR: Use the other constructor for non-compute shaders." << std::endl;
 		return;
 	}
-	const char* compShaderCode = computeCode.c_str();
-	//error handling variables
-	int success{};
-	char infoLog[1024]{};
 
-	// compute Shader
-	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
-	// Specify source code for shader before compiling it
-	glShaderSource(computeShader, 1, &compShaderCode, nullptr);
-	glCompileShader(computeShader);
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(shaderProgramID, length, &length, &binaryFormat, binary.data());
 
-	glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(computeShader, 1024, nullptr, infoLog);
-		std::cerr << "Failed to compile compute Shader!" << std::endl;
-		std::cerr << "InfoLog: " << infoLog << std::endl;
+	// write to a temporary name first so a crash never leaves half a binary behind
+	std::string filePath = programCacheDirectory + "/" + cacheKey + ".bin";
+	std::string tempPath = filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary);
+		if (!file.is_open())
+		{
+			std::cerr << "ERROR: Could not write program cache file: " << tempPath << std::endl;
+			return;
+		}
+		ProgramCacheHeader header{};
+		std::memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+		header.binaryFormat = binaryFormat;
+		header.length = static_cast<uint32_t>(length);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), length);
+		if (!file.good())
+		{
+			std::cerr << "ERROR: Could not write program cache file: " << tempPath << std::endl;
+			return;
+		}
 	}
-	shaderProgramID = glCreateProgram();
-	glAttachShader(shaderProgramID, computeShader);
-	glLinkProgram(shaderProgramID);
 
-	glGetProgramiv(shaderProgramID, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(shaderProgramID, 1024, nullptr, infoLog);
-		std::cerr << "Failed to link shaders!" << std::endl;
-		std::cerr << "InfoLog: " << infoLog << std::endl;
+	std::error_code error;
+	std::filesystem::rename(tempPath, filePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tempPath, error);
+	}
+}
+
+void Shader::SetProgramCacheDirectory(const std::string& directory)
+{
+	programCacheDirectory.clear();
+	if (directory.empty())
+	{
+		return;
 	}
 
-	glDeleteShader(computeShader);
+	// some drivers (older Mesa) support the API but no binary formats at all
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats <= 0)
+	{
+		std::cout << "Program binary cache off: the driver has no program binary formats\n";
+		return;
+	}
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		std::cerr << "ERROR: Could not create program cache directory: " << directory << std::endl;
+		return;
+	}
+	programCacheDirectory = directory;
+}
+
+bool Shader::EnableParallelCompile()
+{
+	// 0xFFFFFFFF = as many threads as the driver wants
+#ifdef GL_KHR_parallel_shader_compile
+	if (GLAD_GL_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+		parallelCompile = true;
+		return true;
+	}
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+	if (GLAD_GL_ARB_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFFu);
+		parallelCompile = true;
+		return true;
+	}
+#endif
+	return false;
+}
+
+void Shader::bindFrameParams() const
+{
+	GLuint blockIndex = glGetUniformBlockIndex(shaderProgramID, "FrameParams");
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(shaderProgramID, blockIndex, frameParamsBinding);
+	}
 }
 
 void Shader::Use() const
@@ -101,39 +343,80 @@ void Shader::Use() const
 // Uniform Setter Implementations
 // ------------------------------
 
+GLint Shader::GetUniformLocation(const std::string& name) const
+{
+	// Only ask the driver the first time, after that it's a hash lookup
+	auto found = uniformLocations.find(name);
+	if (found != uniformLocations.end())
+	{
+		return found->second;
+	}
+
+	GLint location = glGetUniformLocation(shaderProgramID, name.c_str());
+	uniformLocations.emplace(name, location);
+	return location;
+}
+
 void Shader::SetBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(shaderProgramID, name.c_str()), static_cast<int>(value));
+	glUniform1i(GetUniformLocation(name), static_cast<int>(value));
 }
 
 void Shader::SetInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(shaderProgramID, name.c_str()), value);
+	glUniform1i(GetUniformLocation(name), value);
 }
 
 void Shader::SetFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(shaderProgramID, name.c_str()), value);
+	glUniform1f(GetUniformLocation(name), value);
 }
 
 void Shader::SetVec2(const std::string& name, const glm::vec2& value) const
 {
-	glUniform2fv(glGetUniformLocation(shaderProgramID, name.c_str()), 1, glm::value_ptr(value));
+	glUniform2fv(GetUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(shaderProgramID, name.c_str()), 1, glm::value_ptr(value));
+	glUniform3fv(GetUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::SetVec4(const std::string& name, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(shaderProgramID, name.c_str()), 1, glm::value_ptr(value));
+	glUniform4fv(GetUniformLocation(name), 1, glm::value_ptr(value));
 }
 
 void Shader::SetMat4(const std::string& name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgramID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+//replaces lines like #include "FrameParams.glsl" with what load returns for that name
+static std::string expandIncludes(const std::string& source, const std::string& sourceName,
+	const std::function<std::string(const std::string&)>& load)
+{
+	std::stringstream input(source);
+	std::stringstream ss;
+	std::string line;
+	while (std::getline(input, line))
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+		{
+			size_t open = line.find('"', start);
+			size_t close = open != std::string::npos ? line.find('"', open + 1) : std::string::npos;
+			if (close == std::string::npos)
+			{
+				std::cerr << "ERROR: Bad #include in shader file: " << sourceName << ": " << line << std::endl;
+				continue;
+			}
+			ss << load(line.substr(open + 1, close - open - 1)) << "\n";
+			continue;
+		}
+		ss << line << "\n";
+	}
+	return ss.str(); // convert stringstream to string
 }
 
 std::string Shader::LoadShaderFromFile(const std::string& filePath)
@@ -144,10 +427,41 @@ std::string Shader::LoadShaderFromFile(const std::string& filePath)
 		std::cerr << "ERROR: Could not open shader file: " << filePath << std::endl;
 		return "";
 	}
-
-	std::stringstream ss;
-	ss << file.rdbuf(); // read entire file into stringstream
+	std::stringstream contents;
+	contents << file.rdbuf();
 	file.close();
 
-	return ss.str(); // convert stringstream to string
+	// includes are looked up next to the file
+	std::string directory;
+	size_t slash = filePath.find_last_of("/\\");
+	if (slash != std::string::npos)
+	{
+		directory = filePath.substr(0, slash + 1);
+	}
+
+	return expandIncludes(contents.str(), filePath,
+		[&](const std::string& name) { return LoadShaderFromFile(directory + name); });
+}
+
+std::string Shader::LoadShader(const std::string& name)
+{
+	if (!sourceDirectory.empty())
+	{
+		return LoadShaderFromFile(sourceDirectory + "/" + name);
+	}
+
+	for (size_t i = 0; i < embeddedShaderCount; ++i)
+	{
+		if (name == embeddedShaders[i].name)
+		{
+			return expandIncludes(std::string(embeddedShaders[i].source, embeddedShaders[i].size), name, LoadShader);
+		}
+	}
+	std::cerr << "ERROR: No built in shader called: " << name << std::endl;
+	return "";
+}
+
+void Shader::SetSourceDirectory(const std::string& directory)
+{
+	sourceDirectory = directory;
 }
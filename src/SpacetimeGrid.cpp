@@ -0,0 +1,153 @@
+#include <SpacetimeGrid.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+//camera distance at which level 0 is exact to about half a pixel, every doubling of the
+//distance halves the size of an error on screen, so the next level can be twice as coarse
+static const float levelZeroDistance = 325.0f;
+//how far past a level boundary (in doublings of the distance) the camera has to go before switching
+static const float levelHysteresis = 0.1f;
+
+SpacetimeGrid::SpacetimeGrid(float size, int divisions, float warpStrength, float Rs, int levelCount,
+	float baseTolerance)
+	: size(size), divisions(divisions), funnelDepth(warpStrength * Rs), Rs(Rs)
+{
+	std::vector<float> vertices;
+	std::vector<GLuint> indices;
+	for (int level = 0; level < levelCount; ++level)
+	{
+		float tolerance = baseTolerance * std::exp2(static_cast<float>(level));
+		buildLevel(tolerance, vertices, indices);
+
+		Mesh mesh(vertices.data(), vertices.size() * sizeof(float), static_cast<GLsizei>(vertices.size() / 3), indices,
+			{ {0, 3} },  // Only position attribute (vec3)
+			3 * sizeof(float));
+		levels.push_back(GridLevel{ std::move(mesh), tolerance, vertices.size() / 3, indices.size() });
+	}
+}
+
+float SpacetimeGrid::spacingAt(float distance, float tolerance) const
+{
+	//the warp is w(d) = -funnelDepth / d, a straight piece of length h across it is off by at most
+	//h^2 * |w''| / 8 = h^2 * funnelDepth / (4 d^3), so h = sqrt(4 * tolerance * d^3 / funnelDepth).
+	//inside the horizon grid.vert uses a constant depth, so nothing gets finer than at Rs.
+	float cellSize = size / divisions;
+	if (funnelDepth <= 0.0f)
+	{
+		return cellSize;
+	}
+	float d = std::max(distance, Rs);
+	float spacing = std::sqrt(4.0f * tolerance * d * d * d / funnelDepth);
+	return std::clamp(spacing, cellSize / 256.0f, cellSize);
+}
+
+void SpacetimeGrid::buildLevel(float tolerance, std::vector<float>& vertices, std::vector<GLuint>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	// Create a grid of lines in the XY plane (Z=0), centered on the hole
+	float step = size / divisions;
+	float halfSize = size / 2.0f;
+	int pointsPerSide = divisions + 1;
+
+	// The grid points come first, so both lines through a point share its vertex
+	for (int j = 0; j < pointsPerSide; ++j)
+	{
+		for (int i = 0; i < pointsPerSide; ++i)
+		{
+			vertices.push_back(-halfSize + i * step);  // x
+			vertices.push_back(-halfSize + j * step);  // y
+			vertices.push_back(0.0f);                  // z
+		}
+	}
+
+	// Then every cell edge gets the extra vertices its part of the funnel needs
+	auto addEdge = [&](GLuint startIndex, GLuint endIndex, glm::vec2 start, glm::vec2 direction)
+	{
+		GLuint previous = startIndex;
+		float t = 0.0f;
+		while (true)
+		{
+			//the piece has to be short enough at both ends (closer to the hole is the stricter one)
+			glm::vec2 point = start + direction * t;
+			float h = spacingAt(glm::length(point), tolerance);
+			h = std::min(h, spacingAt(glm::length(point + direction * h), tolerance));
+			t += h;
+			if (t >= step - 1.0e-3f * step)
+			{
+				break;
+			}
+
+			glm::vec2 inner = start + direction * t;
+			GLuint current = static_cast<GLuint>(vertices.size() / 3);
+			vertices.push_back(inner.x);
+			vertices.push_back(inner.y);
+			vertices.push_back(0.0f);
+			indices.push_back(previous);
+			indices.push_back(current);
+			previous = current;
+		}
+		indices.push_back(previous);
+		indices.push_back(endIndex);
+	};
+
+	for (int j = 0; j < pointsPerSide; ++j)
+	{
+		for (int i = 0; i < pointsPerSide; ++i)
+		{
+			GLuint index = static_cast<GLuint>(j * pointsPerSide + i);
+			glm::vec2 point(-halfSize + i * step, -halfSize + j * step);
+
+			// Horizontal lines (along X axis)
+			if (i < divisions)
+			{
+				addEdge(index, index + 1, point, glm::vec2(1.0f, 0.0f));
+			}
+			// Vertical lines (along Y axis)
+			if (j < divisions)
+			{
+				addEdge(index, index + pointsPerSide, point, glm::vec2(0.0f, 1.0f));
+			}
+		}
+	}
+}
+
+int SpacetimeGrid::selectLevel(float cameraDistance)
+{
+	float doublings = std::log2(std::max(cameraDistance, 1.0f) / levelZeroDistance);
+	int lastLevel = static_cast<int>(levels.size()) - 1;
+
+	// Only move once the camera is clearly inside the next level's range
+	if (doublings > static_cast<float>(currentLevel + 1) + levelHysteresis
+		|| doublings < static_cast<float>(currentLevel) - levelHysteresis)
+	{
+		currentLevel = static_cast<int>(std::floor(doublings));
+	}
+	currentLevel = std::clamp(currentLevel, 0, lastLevel);
+	return currentLevel;
+}
+
+void SpacetimeGrid::draw(float cameraDistance)
+{
+	levels[selectLevel(cameraDistance)].mesh.draw_Lines();
+}
+
+int SpacetimeGrid::getLevelCount() const
+{
+	return static_cast<int>(levels.size());
+}
+
+const GridLevel& SpacetimeGrid::getLevel(int level) const
+{
+	return levels[level];
+}
+
+size_t SpacetimeGrid::getUniformVertexCount() const
+{
+	// 2 * (divisions + 1) lines, each cut into pieces of the finest spacing
+	float finestSpacing = spacingAt(Rs, levels.empty() ? 0.0f : levels[0].tolerance);
+	size_t piecesPerLine = static_cast<size_t>(std::ceil(size / finestSpacing));
+	return 2 * static_cast<size_t>(divisions + 1) * (piecesPerLine + 1);
+}
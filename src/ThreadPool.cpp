@@ -0,0 +1,210 @@
+#include <ThreadPool.hpp>
+#include <algorithm>
+
+//a deque's [front, back) chunk range lives in one 64 bit word: front in the low half, back in the high half
+static uint64_t packRange(uint64_t front, uint64_t back)
+{
+	return front | (back << 32);
+}
+
+static uint64_t rangeFront(uint64_t range)
+{
+	return range & 0xFFFFFFFFull;
+}
+
+static uint64_t rangeBack(uint64_t range)
+{
+	return range >> 32;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+	if (threadCount == 0)
+	{
+		threadCount = 1; //hardware_concurrency is allowed to return 0
+	}
+
+	deques = std::make_unique<WorkDeque[]>(threadCount);
+
+	//the calling thread also works, so we only spawn count - 1 workers.
+	for (unsigned i = 1; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+unsigned ThreadPool::getThreadCount() const
+{
+	return static_cast<unsigned>(workers.size()) + 1;
+}
+
+unsigned long long ThreadPool::getStealCount() const
+{
+	return stealCount.load(std::memory_order_relaxed);
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, unsigned)>& task)
+{
+	parallelForRange(count, 1, [&](size_t begin, size_t end, unsigned threadIndex)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			task(i, threadIndex);
+		}
+	});
+}
+
+void ThreadPool::parallelForRange(size_t count, size_t chunkSize,
+	const std::function<void(size_t, size_t, unsigned)>& task)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	//chunk indices have to fit in half of a deque's word
+	chunkSize = std::max<size_t>(chunkSize, count / 0xFFFFFFFFull + 1);
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	//no workers (or nothing to share), just run everything here.
+	if (workers.empty() || chunkCount == 1)
+	{
+		for (size_t begin = 0; begin < count; begin += chunkSize)
+		{
+			task(begin, std::min(begin + chunkSize, count), 0);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		taskCount = count;
+		taskChunkSize = chunkSize;
+
+		//every thread starts with an equal run of neighbouring chunks
+		unsigned threadCount = getThreadCount();
+		for (unsigned t = 0; t < threadCount; ++t)
+		{
+			uint64_t front = static_cast<uint64_t>(chunkCount) * t / threadCount;
+			uint64_t back = static_cast<uint64_t>(chunkCount) * (t + 1) / threadCount;
+			deques[t].range.store(packRange(front, back), std::memory_order_relaxed);
+		}
+
+		busyWorkers = static_cast<unsigned>(workers.size());
+		++jobGeneration;
+	}
+	wakeCondition.notify_all();
+
+	//help out with the job on the calling thread
+	runTasks(0);
+
+	//wait for the workers to finish their last chunk
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+	currentTask = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned threadIndex)
+{
+	unsigned long long seenGeneration = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return stopping || jobGeneration != seenGeneration; });
+			if (stopping)
+			{
+				return;
+			}
+			seenGeneration = jobGeneration;
+		}
+
+		runTasks(threadIndex);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--busyWorkers;
+		}
+		doneCondition.notify_one();
+	}
+}
+
+void ThreadPool::runTasks(unsigned threadIndex)
+{
+	//own chunks first, then steal until every deque is empty
+	size_t chunk = 0;
+	while (popChunk(threadIndex, chunk) || stealChunk(threadIndex, chunk))
+	{
+		runChunk(chunk, threadIndex);
+	}
+}
+
+bool ThreadPool::popChunk(unsigned threadIndex, size_t& chunk)
+{
+	std::atomic<uint64_t>& range = deques[threadIndex].range;
+	uint64_t current = range.load(std::memory_order_acquire);
+	while (rangeFront(current) < rangeBack(current))
+	{
+		if (range.compare_exchange_weak(current, packRange(rangeFront(current) + 1, rangeBack(current)),
+			std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			chunk = static_cast<size_t>(rangeFront(current));
+			return true;
+		}
+	}
+	return false;
+}
+
+bool ThreadPool::stealChunk(unsigned threadIndex, size_t& chunk)
+{
+	//look at the other threads in turn, starting with the next one so thieves spread out
+	unsigned threadCount = getThreadCount();
+	for (unsigned offset = 1; offset < threadCount; ++offset)
+	{
+		std::atomic<uint64_t>& victim = deques[(threadIndex + offset) % threadCount].range;
+		uint64_t current = victim.load(std::memory_order_acquire);
+		while (rangeFront(current) < rangeBack(current))
+		{
+			//take the back half (rounded up), the victim keeps going from its front
+			uint64_t front = rangeFront(current);
+			uint64_t back = rangeBack(current);
+			uint64_t middle = back - (back - front + 1) / 2;
+			if (victim.compare_exchange_weak(current, packRange(front, middle),
+				std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				//run the first stolen chunk now, the rest goes in our own (empty) deque for others to steal
+				chunk = static_cast<size_t>(middle);
+				deques[threadIndex].range.store(packRange(middle + 1, back), std::memory_order_release);
+				stealCount.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ThreadPool::runChunk(size_t chunk, unsigned threadIndex)
+{
+	size_t begin = chunk * taskChunkSize;
+	(*currentTask)(begin, std::min(begin + taskChunkSize, taskCount), threadIndex);
+}
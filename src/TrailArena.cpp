@@ -0,0 +1,175 @@
+#include <TrailArena.hpp>
+#include <BlackHole.hpp>
+#include <RayBatch.hpp>
+#include <algorithm>
+#include <cmath>
+
+TrailArena::TrailArena(size_t rayCount, const TrailSettings& settings)
+{
+	reset(rayCount, settings);
+}
+
+void TrailArena::reset(size_t newRayCount, const TrailSettings& newSettings)
+{
+	settings = newSettings;
+	if (settings.capacityPerRay < 2)
+	{
+		settings.capacityPerRay = 2; //need two points for a line
+	}
+	rayCount = newRayCount;
+	minTurnCos = settings.minTurnAngle > 0.0f ? std::cos(settings.minTurnAngle) : 1.0f;
+
+	//resize keeps the old allocation when it's already big enough
+	points.resize(rayCount * settings.capacityPerRay);
+	rings.resize(rayCount);
+	clearAll();
+}
+
+size_t TrailArena::getRayCount() const
+{
+	return rayCount;
+}
+
+size_t TrailArena::getCapacityPerRay() const
+{
+	return settings.capacityPerRay;
+}
+
+const TrailSettings& TrailArena::getSettings() const
+{
+	return settings;
+}
+
+size_t TrailArena::memoryBytes() const
+{
+	return points.capacity() * sizeof(glm::vec2) + rings.capacity() * sizeof(Ring);
+}
+
+void TrailArena::clear(size_t ray)
+{
+	rings[ray] = Ring{ 0, 0 };
+}
+
+void TrailArena::clearAll()
+{
+	for (Ring& ring : rings)
+	{
+		ring = Ring{ 0, 0 };
+	}
+}
+
+size_t TrailArena::slot(size_t ray, const Ring& ring, size_t i) const
+{
+	//index into points[] of the i-th oldest point of this ray
+	return ray * settings.capacityPerRay + (ring.head + i) % settings.capacityPerRay;
+}
+
+void TrailArena::push(size_t ray, glm::vec2 point)
+{
+	Ring& ring = rings[ray];
+
+	if (ring.count >= 2 && minTurnCos < 1.0f)
+	{
+		glm::vec2 last = points[slot(ray, ring, ring.count - 1)];
+		glm::vec2 previous = points[slot(ray, ring, ring.count - 2)];
+		glm::vec2 lastSegment = last - previous;
+		glm::vec2 newSegment = point - last;
+
+		float lastLength = glm::length(lastSegment);
+		float newLength = glm::length(newSegment);
+		if (newLength == 0.0f)
+		{
+			return; // didn't move
+		}
+
+		// Barely turning: slide the last point forward instead of keeping a new one
+		if (lastLength > 0.0f && glm::dot(lastSegment, newSegment) / (lastLength * newLength) > minTurnCos)
+		{
+			points[slot(ray, ring, ring.count - 1)] = point;
+			return;
+		}
+	}
+
+	if (ring.count < settings.capacityPerRay)
+	{
+		points[slot(ray, ring, ring.count)] = point;
+		ring.count++;
+	}
+	else
+	{
+		// Full: overwrite the oldest point
+		points[slot(ray, ring, 0)] = point;
+		ring.head = static_cast<uint32_t>((ring.head + 1) % settings.capacityPerRay);
+	}
+}
+
+void TrailArena::record(const RayBatch& batch, const BlackHole& blackHole)
+{
+	size_t count = std::min(batch.size(), rayCount);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (batch.isActive(i))
+		{
+			push(i, batch.getPosition(i, blackHole));
+		}
+	}
+}
+
+size_t TrailArena::size(size_t ray) const
+{
+	return rings[ray].count;
+}
+
+glm::vec2 TrailArena::at(size_t ray, size_t i) const
+{
+	return points[slot(ray, rings[ray], i)];
+}
+
+glm::vec2 TrailArena::back(size_t ray) const
+{
+	return at(ray, rings[ray].count - 1);
+}
+
+TrailView TrailArena::view(size_t ray) const
+{
+	const Ring& ring = rings[ray];
+	const glm::vec2* base = points.data() + ray * settings.capacityPerRay;
+
+	TrailView result;
+	result.first = base + ring.head;
+	result.firstCount = std::min<size_t>(ring.count, settings.capacityPerRay - ring.head);
+	result.second = base;
+	result.secondCount = ring.count - result.firstCount;
+	return result;
+}
+
+const glm::vec2* TrailArena::data() const
+{
+	return points.data();
+}
+
+void TrailHandle::push(glm::vec2 point) const
+{
+	if (arena)
+	{
+		arena->push(index, point);
+	}
+}
+
+void TrailHandle::clear() const
+{
+	if (arena)
+	{
+		arena->clear(index);
+	}
+}
+
+size_t TrailHandle::size() const
+{
+	return arena ? arena->size(index) : 0;
+}
+
+TrailView TrailHandle::view() const
+{
+	return arena ? arena->view(index) : TrailView();
+}
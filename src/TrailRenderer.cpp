@@ -0,0 +1,149 @@
+#include <TrailRenderer.hpp>
+#include <cstring>
+#include <iostream>
+
+TrailRenderer::TrailRenderer(size_t maxVertices, int sections)
+	: sectionVertices(maxVertices), sectionCount(sections > 0 ? sections : 1)
+{
+	fences.assign(sectionCount, nullptr);
+
+	GLsizeiptr bufferSize = static_cast<GLsizeiptr>(sectionVertices * sectionCount * sizeof(glm::vec2));
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+	//immutable storage that stays mapped for the whole lifetime (coherent, so no flushing needed)
+	glBufferStorage(GL_ARRAY_BUFFER, bufferSize, nullptr, flags);
+	mapped = static_cast<glm::vec2*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bufferSize, flags));
+	if (!mapped)
+	{
+		std::cerr << "ERROR: Could not map the trail buffer, trails will not be drawn" << std::endl;
+	}
+
+	// points are plain vec2s in pixel space (main.vert reads aPos as vec2)
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindVertexArray(0);
+}
+
+TrailRenderer::~TrailRenderer()
+{
+	for (GLsync& fence : fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+		}
+	}
+
+	if (mapped)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	glDeleteBuffers(1, &VBO);
+	glDeleteVertexArrays(1, &VAO);
+}
+
+void TrailRenderer::waitForSection(int section)
+{
+	GLsync& fence = fences[section];
+	if (!fence)
+	{
+		return;
+	}
+
+	//usually already signalled, only waits if the CPU got a whole ring ahead of the GPU
+	while (true)
+	{
+		GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);  // 1 second
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+		{
+			break;
+		}
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void TrailRenderer::draw(const TrailArena& trails, Shader& shader, const glm::mat4& projection, glm::vec4 color)
+{
+	lastVertexCount = 0;
+	firsts.clear();
+	counts.clear();
+	if (!mapped)
+	{
+		return;
+	}
+
+	// only grows the first time (or if the arena gets more rays)
+	if (firsts.capacity() < trails.getRayCount())
+	{
+		firsts.reserve(trails.getRayCount());
+		counts.reserve(trails.getRayCount());
+	}
+
+	waitForSection(currentSection);
+
+	const size_t base = static_cast<size_t>(currentSection) * sectionVertices;
+	glm::vec2* out = mapped + base;
+	size_t written = 0;
+
+	for (size_t ray = 0; ray < trails.getRayCount(); ++ray)
+	{
+		TrailView trail = trails.view(ray);
+		size_t count = trail.size();
+		if (count < 2) continue;  // Need at least 2 points for a line
+
+		if (written + count > sectionVertices)
+		{
+			if (!warnedOverflow)
+			{
+				std::cerr << "ERROR: Trail buffer is full, some trails are not drawn" << std::endl;
+				warnedOverflow = true;
+			}
+			break;
+		}
+
+		// Oldest point first, the ring can wrap so copy both pieces
+		std::memcpy(out + written, trail.first, trail.firstCount * sizeof(glm::vec2));
+		std::memcpy(out + written + trail.firstCount, trail.second, trail.secondCount * sizeof(glm::vec2));
+
+		firsts.push_back(static_cast<GLint>(base + written));
+		counts.push_back(static_cast<GLsizei>(count));
+		written += count;
+	}
+	lastVertexCount = written;
+
+	if (!firsts.empty())
+	{
+		shader.Use();
+		shader.SetMat4("u_Projection", projection);
+		shader.SetMat4("u_View", glm::mat4(1.0f));
+		shader.SetMat4("u_Model", glm::mat4(1.0f));
+		shader.SetVec4("u_Color", color);
+
+		glBindVertexArray(VAO);
+		glMultiDrawArrays(GL_LINE_STRIP, firsts.data(), counts.data(), static_cast<GLsizei>(firsts.size()));
+		glBindVertexArray(0);
+	}
+
+	// This section is free again once the GPU is past this point
+	fences[currentSection] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	currentSection = (currentSection + 1) % sectionCount;
+}
+
+size_t TrailRenderer::getLastVertexCount() const
+{
+	return lastVertexCount;
+}
+
+GLsizei TrailRenderer::getLastDrawCount() const
+{
+	return static_cast<GLsizei>(firsts.size());
+}
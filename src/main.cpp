@@ -2,19 +2,46 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>                // core types (vec3, mat4, etc.)
 #include <glm/gtc/matrix_transform.hpp> // for translate, rotate, scale, perspective, etc
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <thread>
 #include <Mesh.hpp>
+#include <SpacetimeGrid.hpp>
 #include <Shader.hpp>
 #include <BlackHole.hpp>
 #include <Camera.hpp>
 #include <Graphics.hpp>
-std::string vertShader = "../../../Shaders/main.vert";
-std::string fragShader = "../../../Shaders/main.frag";
-std::string QuadfragShader = "../../../Shaders/quad.frag";
-std::string QuadvertShader = "../../../Shaders/quad.vert";
-std::string CompShader = "../../../Shaders/geodesic.comp";
-std::string GridvertShader = "../../../Shaders/grid.vert";
-std::string GridfragShader = "../../../Shaders/grid.frag";
+#include <LensMapCache.hpp>
+#include <CpuRenderer.hpp>
+#include <CommandLine.hpp>
+#include <DeflectionTable.hpp>
+#include <FrameParams.hpp>
+#include <RayBatch.hpp>
+#include <RaySimulation.hpp>
+#include <PhotonSystem.hpp>
+#include <CausticMap.hpp>
+#include <CausticRenderer.hpp>
+#include <TrailRenderer.hpp>
+#include <Profiler.hpp>
+#include <CameraPath.hpp>
+#include <FrameWriter.hpp>
+// Shaders are built into the executable (see cmake/EmbedShaders.cmake), --shader-dir reads them from disk instead
+std::string vertShader = "main.vert";
+std::string fragShader = "main.frag";
+std::string QuadfragShader = "quad.frag";
+std::string QuadvertShader = "quad.vert";
+std::string CompShader = "geodesic.comp";
+std::string GridvertShader = "grid.vert";
+std::string GridfragShader = "grid.frag";
+std::string PhotonCompShader = "photons.comp";
+std::string PhotonvertShader = "photons.vert";
+std::string PhotonfragShader = "photons.frag";
+std::string CausticCompShader = "caustics.comp";
+std::string CausticvertShader = "caustics.vert";
+std::string CausticfragShader = "caustics.frag";
 
 bool mousePressed = false;
 double lastX = 400.0, lastY = 300.0;
@@ -23,12 +50,20 @@ bool firstMouse = true;
 // Global camera pointer for callbacks
 Camera* g_camera = nullptr;
 
+// New framebuffer size from the resize callback, the render loop resizes the trace textures
+int g_framebufferWidth = 0;
+int g_framebufferHeight = 0;
+bool g_framebufferResized = false;
+
 //========================
 //========================
 // Callback to adjust viewport on window resize
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    g_framebufferWidth = width;
+    g_framebufferHeight = height;
+    g_framebufferResized = true;
 }
 
 // Mouse button callback - track when mouse is pressed/released
@@ -82,48 +117,293 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     }
 }
 
-void renderTrail(const std::vector<glm::vec2>& trail, Shader& shader, const glm::mat4& projection)
+// Halton low discrepancy sequence (0..1), used to spread the jittered samples evenly over a pixel
+static float halton(int index, int base)
+{
+    float result = 0.0f;
+    float fraction = 1.0f / static_cast<float>(base);
+    while (index > 0)
+    {
+        result += fraction * static_cast<float>(index % base);
+        index /= base;
+        fraction /= static_cast<float>(base);
+    }
+    return result;
+}
+
+// Projection of the 2D overlays (trails, photons, caustics), drawn in scene coordinates (0..sceneSize).
+// The scene keeps its aspect ratio and stays centred in the viewport, like the traced image does when
+// the window is resized (it fills the window's height, the sides show more or less of it).
+static glm::mat4 overlayProjection(glm::vec2 sceneSize, glm::vec2 viewportSize)
+{
+    glm::vec2 center = sceneSize * 0.5f;
+    float halfHeight = sceneSize.y * 0.5f;
+    float halfWidth = halfHeight * viewportSize.x / viewportSize.y;
+    return glm::ortho(center.x - halfWidth, center.x + halfWidth, center.y - halfHeight, center.y + halfHeight, -1.0f, 1.0f);
+}
+
+// Kernel inputs for the headless renderers (same values the compute shader gets from FrameParams)
+static TraceParams makeTraceParams(const AppOptions& options, const BlackHole& blackHole, const Camera& camera)
+{
+    TraceParams params;
+    params.blackHolePos = blackHole.position;
+    params.mass = static_cast<float>(blackHole.mass);
+    params.Rs = static_cast<float>(blackHole.schwarzschildRadius);
+    params.screenSize = glm::vec2(static_cast<float>(options.width), static_cast<float>(options.height));
+    params.cameraPos = camera.getPosition();
+    params.cameraFOV = camera.fov;
+    params.integrator = options.adaptive ? 1 : 0;
+    params.tolerance = options.tolerance;
+    params.hierarchical = options.hierarchical;
+    return params;
+}
+
+// Render frames on the CPU without a window and report the throughput
+int runCpuRender(const AppOptions& options, const BlackHole& blackHole, const Camera& camera)
+{
+    TraceParams params = makeTraceParams(options, blackHole, camera);
+
+    CpuRenderer renderer(options.width, options.height, options.threads);
+
+    // The table only depends on the mass, build it once up front
+    std::unique_ptr<DeflectionTable> table;
+    if (options.lookup)
+    {
+        ThreadPool buildPool(options.threads);
+        table = std::make_unique<DeflectionTable>(blackHole, DeflectionTableSettings(), &buildPool);
+        std::cout << "Deflection table built in " << table->getBuildSeconds() * 1000.0 << " ms\n";
+        params.renderMode = 1;
+        params.deflectionTable = table.get();
+    }
+    std::cout << "=== CPU RENDER ===\n";
+    std::cout << "Resolution: " << options.width << "x" << options.height << "\n";
+    std::cout << "Threads: " << renderer.getThreadCount() << "\n";
+    std::cout << "Integrator: " << (options.lookup ? "deflection table lookup" :
+                                    options.adaptive ? "adaptive Dormand-Prince 5(4)" : "fixed step RK4");
+    if (options.adaptive)
+    {
+        std::cout << " (tolerance " << options.tolerance << ")";
+    }
+    std::cout << "\n";
+    if (params.hierarchical && !options.lookup)
+    {
+        std::cout << "Coarse-to-fine: " << coarseTileSize << "x" << coarseTileSize << " tiles\n";
+    }
+
+    // CPU only timings, there's no GL context here
+    std::unique_ptr<Profiler> profiler;
+    if (!options.profilePath.empty())
+    {
+        profiler = std::make_unique<Profiler>(false);
+    }
+
+    double totalSeconds = 0.0;
+    unsigned long long totalRays = 0;
+    unsigned long long totalSteps = 0;
+    unsigned long long totalRejected = 0;
+    unsigned long long totalPixels = 0;
+    for (int frame = 0; frame < options.frames; ++frame)
+    {
+        if (profiler) profiler->beginFrame();
+        {
+            ProfileZone zone(profiler.get(), "render");
+            renderer.render(params);
+        }
+        if (profiler) profiler->endFrame();
+        const RenderStats& stats = renderer.getLastStats();
+        totalSeconds += stats.seconds;
+        totalRays += stats.rays;
+        totalSteps += stats.steps;
+        totalRejected += stats.rejectedSteps;
+        totalPixels += stats.pixels;
+        std::cout << "Frame " << frame << ": " << stats.seconds * 1000.0 << " ms, "
+                  << stats.raysPerSecond / 1.0e6 << " Mrays/s";
+        if (stats.tiles > 0)
+        {
+            std::cout << ", refined " << stats.refinedTiles << " of " << stats.tiles << " tiles";
+        }
+        std::cout << "\n";
+    }
+
+    std::cout << "Average: " << (totalSeconds / options.frames) * 1000.0 << " ms/frame, "
+              << (totalSeconds > 0.0 ? totalRays / totalSeconds / 1.0e6 : 0.0) << " Mrays/s, "
+              << static_cast<double>(totalSteps) / totalRays << " steps/ray, "
+              << static_cast<double>(totalSteps) / totalPixels << " steps/pixel, "
+              << static_cast<double>(totalRejected) / totalRays << " rejected steps/ray\n";
+
+    if (profiler)
+    {
+        profiler->flush();
+        if (profiler->writeFile(options.profilePath))
+        {
+            std::cout << "Wrote profile " << options.profilePath << "\n";
+        }
+    }
+
+    if (!renderer.writePPM(options.outputPath))
+    {
+        return -1;
+    }
+    std::cout << "Wrote " << options.outputPath << "\n";
+    return 0;
+}
+
+// The caustic map's grid covers the window one cell per pixel, in the same units as the trails
+static CausticSettings makeCausticSettings(const AppOptions& options)
+{
+    CausticSettings settings;
+    settings.gridWidth = options.width;
+    settings.gridHeight = options.height;
+    settings.sceneSize = glm::vec2(static_cast<float>(options.width), static_cast<float>(options.height));
+    return settings;
+}
+
+// Build a caustic map on the CPU (--cpu --caustics N) and write it out log scaled
+int runCausticMap(const AppOptions& options, const BlackHole& blackHole)
+{
+    ThreadPool pool(options.threads);
+    CausticMap map(makeCausticSettings(options));
+
+    std::cout << "=== CAUSTIC MAP ===\n";
+    std::cout << "Grid: " << options.width << "x" << options.height << ", " << options.causticRays << " rays\n";
+    std::cout << "Threads: " << pool.getThreadCount() << " (" << simdLevelName(detectSimdLevel()) << ")\n";
+
+    map.build(static_cast<size_t>(options.causticRays), blackHole, pool);
+
+    double seconds = map.getBuildSeconds();
+    std::cout << "Built in " << seconds * 1000.0 << " ms: "
+              << (seconds > 0.0 ? map.getRayCount() / seconds / 1.0e6 : 0.0) << " Mrays/s, "
+              << (seconds > 0.0 ? map.getStepCount() / seconds / 1.0e6 : 0.0) << " Msteps/s, "
+              << static_cast<double>(map.getStepCount()) / std::max<size_t>(map.getRayCount(), 1) << " steps/ray, "
+              << "densest cell " << map.getMaxCount() << "\n";
+
+    if (!map.writePPM(options.outputPath))
+    {
+        return -1;
+    }
+    std::cout << "Wrote " << options.outputPath << "\n";
+    return 0;
+}
+
+// Render a keyframed camera path headless, one frame per 1/fps seconds. The frames are pipelined:
+// while frame N is traced, the FrameWriter thread converts and writes frame N-1.
+int runAnimation(const AppOptions& options, const BlackHole& blackHole, Camera camera)
 {
-    if (trail.size() < 2) return;  // Need at least 2 points for a line
+    CameraPath path;
+    if (options.cameraPathFile.empty())
+    {
+        path = CameraPath::orbit(camera, options.duration > 0.0f ? options.duration : 8.0f);
+    }
+    else if (!path.loadFromFile(options.cameraPathFile))
+    {
+        return -1;
+    }
 
-    // Create vertices from trail points
-    std::vector<float> vertices;
-    for (const auto& point : trail)
+    float duration = options.duration > 0.0f ? options.duration : path.getDuration();
+    int frameCount = std::max(1, static_cast<int>(std::lround(duration * options.fps)));
+
+    FrameFormat format = FrameWriter::formatForPath(options.outputPath);
+    FrameWriter writer(format, options.outputPath, options.width, options.height, options.fps);
+    if (!writer.isOpen())
     {
-        vertices.push_back(point.x);
-        vertices.push_back(point.y);
-        vertices.push_back(0.0f);  // z = 0 (2D)
+        return -1;
     }
 
-    // Create VAO, VBO
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // stdout might be the video stream, so the report goes to stderr then
+    std::ostream& log = options.outputPath == "-" ? std::cerr : std::cout;
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_DYNAMIC_DRAW);
+    CpuRenderer renderer(options.width, options.height, options.threads);
+    TraceParams params = makeTraceParams(options, blackHole, camera);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    std::unique_ptr<DeflectionTable> table;
+    if (options.lookup)
+    {
+        ThreadPool buildPool(options.threads);
+        table = std::make_unique<DeflectionTable>(blackHole, DeflectionTableSettings(), &buildPool);
+        params.renderMode = 1;
+        params.deflectionTable = table.get();
+    }
 
-    // Set uniforms and draw
-    shader.Use();
-    shader.SetMat4("u_Projection", projection);
-    shader.SetMat4("u_View", glm::mat4(1.0f));
-    shader.SetMat4("u_Model", glm::mat4(1.0f));  // Identity matrix
-    shader.SetVec4("u_Color", glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));  // Yellow trail
+    log << "=== ANIMATION ===\n";
+    log << "Resolution: " << options.width << "x" << options.height << ", " << frameCount << " frames at "
+        << options.fps << " fps (" << duration << " s), " << path.getKeyframes().size() << " keyframes\n";
+    log << "Threads: " << renderer.getThreadCount() << "\n";
+    log << "Output: " << (options.outputPath == "-" ? "Y4M to stdout" : options.outputPath) << "\n";
 
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_LINE_STRIP, 0, trail.size());
+    auto start = std::chrono::steady_clock::now();
+    double renderSeconds = 0.0;
+    bool ok = true;
+    for (int frame = 0; frame < frameCount && ok; ++frame)
+    {
+        path.apply(camera, static_cast<float>(frame) / static_cast<float>(options.fps));
+        params.cameraPos = camera.getPosition();
+        params.cameraFOV = camera.fov;
 
-    // Cleanup
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+        renderer.render(params);
+        renderSeconds += renderer.getLastStats().seconds;
+
+        // copies the pixels and returns, the writer thread does the rest while we trace the next frame
+        ok = writer.submit(renderer.getPixels());
+
+        if ((frame + 1) % options.fps == 0 || frame + 1 == frameCount)
+        {
+            log << "Frame " << frame + 1 << "/" << frameCount << "\n";
+        }
+    }
+    ok = writer.finish() && ok;
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int written = writer.getFramesWritten();
+    log << "Wrote " << written << " frames in " << totalSeconds << " s: "
+        << (totalSeconds > 0.0 ? written / totalSeconds : 0.0) << " frames/s\n";
+    log << "Per frame: " << renderSeconds / frameCount * 1000.0 << " ms tracing, "
+        << writer.getWriteSeconds() / std::max(written, 1) * 1000.0 << " ms writing (background), "
+        << writer.getWaitSeconds() / frameCount * 1000.0 << " ms waiting for the writer\n";
+    return ok ? 0 : -1;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    AppOptions options;
+    if (!parseCommandLine(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return -1;
+    }
+    if (options.showHelp)
+    {
+        printUsage(argv[0]);
+        return 0;
+    }
+
+    // Scene setup (shared by the window and the headless CPU renderer)
+    // Black hole sits at (x, y) in pixel coordinates
+    float x = 400.0f;
+    float y = 300.0f;
+    float radius = 40.0f;
+
+    float desiredRs = 40.0f;
+    double mass = (desiredRs * C * C) / (2.0 * G);
+    BlackHole blackHole(glm::vec2(x, y), mass);
+    // Camera and mouse tracking
+    // Camera orbits around black hole at (x, 0, y) on the ground plane
+    Camera camera(glm::vec3(x, 0.0f, y), 650.0f);
+    camera.elevation = 1.3f;   // Look down from above to see horizontal disk
+    camera.azimuth = 0.8f;     // Diagonal view like reference
+
+    if (options.animate)
+    {
+        return runAnimation(options, blackHole, camera);
+    }
+    if (options.cpuRender && options.causticRays > 0)
+    {
+        return runCausticMap(options, blackHole);
+    }
+    if (options.cpuRender)
+    {
+        return runCpuRender(options, blackHole, camera);
+    }
+
     // Initialize GLFW
     if (!glfwInit())
     {
@@ -131,9 +411,11 @@ int main()
         return -1;
     }
 
-    // Set GLFW to use OpenGL 3.3 Core Profile
+    // Set GLFW to use OpenGL 4.5 Core Profile: the direct state access calls (glCreateTextures, glGetNamedBufferSubData, ...)
+    // are 4.5, the persistent mapped trail buffer needs glBufferStorage (4.4), and the quad, photon and caustic
+    // shaders are #version 450 (geodesic.comp and grid.* only need 430)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
@@ -141,7 +423,7 @@ int main()
 #endif
 
     // Create window
-    GLFWwindow* window = glfwCreateWindow(800, 600, "BLACK_HOLE_SIM", nullptr, nullptr);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "BLACK_HOLE_SIM", nullptr, nullptr);
     if (!window)
     {
         std::cerr << "Failed to create GLFW window\n";
@@ -160,14 +442,14 @@ int main()
     }
 
     // Set viewport and callbacks
-    glViewport(0, 0, 800, 600);
+    glViewport(0, 0, options.width, options.height);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
 
-    float screenWidth = 800.0f;
-    float screenHeight = 600.0f;
+    float screenWidth = static_cast<float>(options.width);
+    float screenHeight = static_cast<float>(options.height);
     
     //auto circleVertices = Mesh::generateCircleVertices(1.0f, 64);
 
@@ -180,45 +462,148 @@ int main()
     //);
     //circleMesh.setColor(glm::vec4(1.0f, 0.0f, 0.0f, 1.0f));//set to red for now.
 
-    //std::string vertCode = Shader::LoadShaderFromFile(vertShader);
-    //std::string fragCode = Shader::LoadShaderFromFile(fragShader);
-    //Shader mainShader(vertCode, fragCode);
-
-	std::string quadVertCode = Shader::LoadShaderFromFile(QuadvertShader);
-	std::string quadFragCode = Shader::LoadShaderFromFile(QuadfragShader);
-	Shader quadShader(quadVertCode, quadFragCode);
-
-    //convert the comp shader into a string
-	std::string computeCode = Shader::LoadShaderFromFile(CompShader);
-	Shader computeShader(computeCode, true);
+    // Start building every program at once. With parallel compile the driver works on all of them
+    // in the background while the buffers, textures and deflection table below get set up,
+    // programs built on an earlier run come straight out of the program binary cache.
+    auto shaderStart = std::chrono::steady_clock::now();
+    Shader::SetSourceDirectory(options.shaderDirectory);
+    Shader::SetProgramCacheDirectory(options.programCacheDirectory);
+    bool parallelCompile = Shader::EnableParallelCompile();
+
+    Shader mainShader({ { GL_VERTEX_SHADER, Shader::LoadShader(vertShader) },
+                        { GL_FRAGMENT_SHADER, Shader::LoadShader(fragShader) } });
+	Shader quadShader({ { GL_VERTEX_SHADER, Shader::LoadShader(QuadvertShader) },
+	                    { GL_FRAGMENT_SHADER, Shader::LoadShader(QuadfragShader) } });
+	Shader computeShader({ { GL_COMPUTE_SHADER, Shader::LoadShader(CompShader) } });
+    // grid shader for spacetime visualization
+    Shader gridShader({ { GL_VERTEX_SHADER, Shader::LoadShader(GridvertShader) },
+                        { GL_FRAGMENT_SHADER, Shader::LoadShader(GridfragShader) } });
+    // GPU photon stream (--photons N), only built when it's used
+    std::unique_ptr<Shader> photonComputeShader;
+    std::unique_ptr<Shader> photonShader;
+    if (options.photons > 0)
+    {
+        photonComputeShader = std::make_unique<Shader>(std::vector<ShaderStage>{
+            { GL_COMPUTE_SHADER, Shader::LoadShader(PhotonCompShader) } });
+        photonShader = std::make_unique<Shader>(std::vector<ShaderStage>{
+            { GL_VERTEX_SHADER, Shader::LoadShader(PhotonvertShader) },
+            { GL_FRAGMENT_SHADER, Shader::LoadShader(PhotonfragShader) } });
+    }
+    // caustic map (--caustics N)
+    std::unique_ptr<Shader> causticComputeShader;
+    std::unique_ptr<Shader> causticShader;
+    if (options.causticRays > 0)
+    {
+        causticComputeShader = std::make_unique<Shader>(std::vector<ShaderStage>{
+            { GL_COMPUTE_SHADER, Shader::LoadShader(CausticCompShader) } });
+        causticShader = std::make_unique<Shader>(std::vector<ShaderStage>{
+            { GL_VERTEX_SHADER, Shader::LoadShader(CausticvertShader) },
+            { GL_FRAGMENT_SHADER, Shader::LoadShader(CausticfragShader) } });
+    }
 
-    // Load grid shader for spacetime visualization
-    std::string gridVertCode = Shader::LoadShaderFromFile(GridvertShader);
-    std::string gridFragCode = Shader::LoadShaderFromFile(GridfragShader);
-    Shader gridShader(gridVertCode, gridFragCode);
-    std::cout << "Grid shader loaded successfully\n";
+    // Per-frame parameters shared by every program (binding = 0)
+    FrameParamsBuffer frameParamsBuffer;
+
+    // Integrator step counters written by geodesic.comp (binding = 1)
+    GLuint integratorStatsBuffer;
+    glGenBuffers(1, &integratorStatsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, integratorStatsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, integratorStatsBuffer);
+    const int statsReportInterval = 120;  // frames between reads (reading back waits for the GPU)
+    int frameCounter = 0;
+
+    // Progressive refinement: samples accumulated since the view last changed
+    const int maxAccumulatedSamples = 64;
+    int sampleIndex = 0;
+    BlackHole tracedBlackHole = blackHole;
+
+    // Coarse-to-fine tracing (the lookup mode is cheap per pixel, so it always does every pixel)
+    bool hierarchical = options.hierarchical && !options.lookup;
+
+    // Lens maps: while the camera moves, the first sample of a view comes from a map traced for its
+    // distance and elevation (the lookup mode is a table read per pixel already, it doesn't need them)
+    std::unique_ptr<LensMapCache> lensCache;
+    if (options.lensCacheMB > 0 && !options.lookup)
+    {
+        lensCache = std::make_unique<LensMapCache>(static_cast<size_t>(options.lensCacheMB) << 20);
+    }
 
     //generate a quad to will up the window.
 	Graphics graphics(static_cast<int>(screenWidth), static_cast<int>(screenHeight));
     graphics.bindForCompute();//making sure that the current computer shader is active.
 
+    // Lookup mode: precompute every light path once for this black hole
+    if (options.lookup)
+    {
+        ThreadPool buildPool;
+        DeflectionTable table(blackHole, DeflectionTableSettings(), &buildPool);
+        std::cout << "Deflection table built in " << table.getBuildSeconds() * 1000.0 << " ms\n";
+        graphics.uploadDeflectionTable(table);
+    }
+
+    // Recording (--record FILE): the traced image is read back through the PBO ring a few frames
+    // late and handed to a FrameWriter, so neither the readback nor the file writing holds up a frame
+    std::unique_ptr<FrameWriter> recorder;
+    uint64_t recordFrame = 0;
+    if (!options.recordPath.empty())
+    {
+        recorder = std::make_unique<FrameWriter>(FrameWriter::formatForPath(options.recordPath), options.recordPath,
+            graphics.getWidth(), graphics.getHeight(), options.fps, 8);
+        if (!recorder->isOpen())
+        {
+            return -1;
+        }
+        graphics.enableReadback(3);
+    }
+    ReadbackConsumer recordFrameTo = [&](const unsigned char* rgba, int width, int height, uint64_t /*frame*/)
+    {
+        if (width == options.width && height == options.height)
+        {
+            recorder->submit(rgba);  // copies into the writer's queue, the mapped buffer is reused after this
+        }
+    };
+    // Write out the frames still in flight and close the recording
+    auto stopRecording = [&]()
+    {
+        graphics.collectReadbacks(recordFrameTo, true);
+        recorder->finish();
+        std::cout << "Recorded " << recorder->getFramesWritten() << " frames to " << options.recordPath
+                  << " (" << graphics.getDroppedReadbacks() << " skipped because the readback fell behind)\n";
+        graphics.disableReadback();
+        recorder.reset();
+    };
+
+    // Now wait for the programs (usually done by now)
+    bool shadersOk = true;
+    int cachedPrograms = 0;
+    std::vector<Shader*> programs = { &mainShader, &quadShader, &computeShader, &gridShader };
+    if (photonShader)
+    {
+        programs.push_back(photonComputeShader.get());
+        programs.push_back(photonShader.get());
+    }
+    if (causticShader)
+    {
+        programs.push_back(causticComputeShader.get());
+        programs.push_back(causticShader.get());
+    }
+    for (Shader* shader : programs)
+    {
+        shadersOk = shader->Finish() && shadersOk;
+        cachedPrograms += shader->IsFromCache() ? 1 : 0;
+    }
+    double shaderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count();
+    std::cout << "Shaders " << (shadersOk ? "ready" : "FAILED") << " in " << shaderMs << " ms ("
+              << cachedPrograms << " of " << programs.size() << " from the program cache, parallel compile "
+              << (parallelCompile ? "on" : "off") << ")\n";
+
     //float x = 0.7f;     // move 0.5 units to the right
     //float y = -0.3f;    // move 0.3 units down
     //float radius = 0.5f; // scale the circle (default is 1.0)
-    glm::mat4 projection = glm::ortho(0.0f, screenWidth, 0.0f, screenHeight, -1.0f, 1.0f);
-    // After (using pixel coordinates):
-    float x = 400.0f;
-    float y = 300.0f;
-    float radius = 40.0f;
-
-    float desiredRs = 40.0f;
-    double mass = (desiredRs * C * C) / (2.0 * G);
-    BlackHole blackHole(glm::vec2(x, y), mass);
-    // Camera and mouse tracking
-    // Camera orbits around black hole at (x, 0, y) on the ground plane
-    Camera camera(glm::vec3(x, 0.0f, y), 650.0f);
-    camera.elevation = 1.3f;   // Look down from above to see horizontal disk
-    camera.azimuth = 0.8f;     // Diagonal view like reference
+    // the 2D scene is the window's starting size, rebuilt for the new viewport when the window is resized
+    const glm::vec2 sceneSize(screenWidth, screenHeight);
+    glm::mat4 projection = overlayProjection(sceneSize, sceneSize);
 
     // Set global camera pointer for callbacks
     g_camera = &camera;
@@ -237,91 +622,356 @@ int main()
     std::cout << "W/S KEYS: Zoom in/out\n";
     std::cout << "ESC: Close window\n\n";
 
-    // Create spacetime grid mesh
+    // Create spacetime grid (levels of detail, denser near the hole, see SpacetimeGrid.hpp)
     float gridSize = 1500.0f;  // LARGER grid to show more spacetime
-    int gridDivisions = 50;     // 50x50 grid (finer detail)
-    auto gridVertices = Mesh::generateGridVertices(gridSize, gridDivisions);
-    Mesh gridMesh(
-        gridVertices.data(),
-        gridVertices.size() * sizeof(float),
-        static_cast<GLsizei>(gridVertices.size() / 3),
-        { {0, 3} },  // Only position attribute (vec3)
-        3 * sizeof(float)
-    );
-
-    std::cout << "Grid created: " << gridDivisions << "x" << gridDivisions
-              << " (" << gridVertices.size() / 3 << " vertices)\n";
-
-    //std::vector<LightRay> lightRays;
-
-    //// === LIGHT SOURCE: Spray of rays from one point ===
-    //glm::vec2 sourcePosition(100.0f, 300.0f);  // Single point on the left
-    //int numRays = 30;  // Number of rays in the fan
-    //float spreadAngle = 60.0f;  // Total spread in degrees (±30°)
-
-    //for (int i = 0; i < numRays; i++)
-    //{
-    //    LightRay ray;
-
-    //    // Calculate angle for this ray
-    //    float angleOffset = -spreadAngle / 2.0f + (spreadAngle / (numRays - 1)) * i;
-    //    float angleRadians = glm::radians(angleOffset);  // Convert to radians
-
-    //    // Base velocity pointing right (toward black hole)
-    //    float speed = 70.0f;
-    //    float baseAngle = 0.0f;  // 0° = pointing right
-
-    //    // Rotate velocity by angleOffset
-    //    float finalAngle = baseAngle + angleRadians;
-    //    glm::vec2 velocity(
-    //        speed * std::cos(finalAngle),
-    //        speed * std::sin(finalAngle)
-    //    );
-
-    //    ray.initialize(sourcePosition, velocity, blackHole);
-    //    lightRays.push_back(ray);
-    //}
-
-    //std::cout << "Created " << numRays << " rays from ("
-    //    << sourcePosition.x << ", " << sourcePosition.y << ")\n";
-    //std::cout << "Spread: ±" << spreadAngle / 2.0f << " degrees\n";
+    int gridDivisions = 50;     // 50x50 grid
+    float gridWarpStrength = 400.0f;  // MUCH stronger warp for deep funnel!
+    SpacetimeGrid grid(gridSize, gridDivisions, gridWarpStrength, static_cast<float>(blackHole.schwarzschildRadius));
+
+    std::cout << "Grid created: " << gridDivisions << "x" << gridDivisions << ", vertices per level:";
+    for (int level = 0; level < grid.getLevelCount(); ++level)
+    {
+        std::cout << " " << grid.getLevel(level).vertexCount;
+    }
+    std::cout << " (uniformly subdivided: " << grid.getUniformVertexCount() << ")\n";
+
+    // === LIGHT SOURCE: Spray of rays from one point (--trails N) ===
+    // the whole fan is stepped as one RayBatch on the simulation thread (--sim-rate steps per second),
+    // the window records the blended positions it gets back into one TrailArena
+    // and draws them with a single call by the TrailRenderer
+    RayBatch lightRays;
+    std::unique_ptr<RaySimulation> raySimulation;
+    std::vector<glm::vec2> rayPositions;
+    std::vector<uint8_t> rayActive;
+    TrailSettings trailSettings;
+    trailSettings.capacityPerRay = 512;
+    trailSettings.minTurnAngle = glm::radians(0.5f);  // skip points on the straight parts
+    TrailArena trails(options.trailRays, trailSettings);
+    std::unique_ptr<TrailRenderer> trailRenderer;
+
+    if (options.trailRays > 0)
+    {
+        glm::vec2 sourcePosition(100.0f, 300.0f);  // Single point on the left
+        int numRays = options.trailRays;  // Number of rays in the fan
+        float spreadAngle = 60.0f;  // Total spread in degrees (±30°)
+
+        lightRays.reserve(numRays);
+        for (int i = 0; i < numRays; i++)
+        {
+            // Calculate angle for this ray
+            float angleOffset = numRays > 1 ? -spreadAngle / 2.0f + (spreadAngle / (numRays - 1)) * i : 0.0f;
+            float angleRadians = glm::radians(angleOffset);  // Convert to radians
+
+            // Base velocity pointing right (toward black hole)
+            float speed = 70.0f;
+            float baseAngle = 0.0f;  // 0° = pointing right
+
+            // Rotate velocity by angleOffset
+            float finalAngle = baseAngle + angleRadians;
+            glm::vec2 velocity(
+                speed * std::cos(finalAngle),
+                speed * std::sin(finalAngle)
+            );
+
+            lightRays.addRay(sourcePosition, velocity, blackHole);
+            trails.push(i, sourcePosition);
+        }
+
+        trailRenderer = std::make_unique<TrailRenderer>(trails.getRayCount() * trails.getCapacityPerRay());
+        raySimulation = std::make_unique<RaySimulation>(std::move(lightRays), blackHole, 1.0 / options.simRate,
+            options.threads);
+        raySimulation->start();
+
+        std::cout << "Created " << numRays << " rays from ("
+            << sourcePosition.x << ", " << sourcePosition.y << ")\n";
+        std::cout << "Spread: ±" << spreadAngle / 2.0f << " degrees\n";
+        std::cout << "Trail memory: " << trails.memoryBytes() / 1024 << " KB\n";
+        std::cout << "Simulation: " << options.simRate << " steps per second on its own thread\n";
+    }
+
+    // === GPU PHOTON STREAM (--photons N) ===
+    // stepped by photons.comp and drawn by photons.vert straight from the same storage buffers,
+    // --sim-rate steps per second of real time (a few per frame at most, so a slow GPU just slows them down)
+    std::unique_ptr<PhotonSystem> photons;
+    const float photonStep = 1.0f / options.simRate;
+    const int maxPhotonStepsPerFrame = 8;
+    float photonTime = 0.0f;
+    if (options.photons > 0)
+    {
+        if (!PhotonSystem::isSupported())
+        {
+            std::cerr << "ERROR: This driver can't read storage buffers in vertex shaders, --photons needs it" << std::endl;
+            return -1;
+        }
+
+        PhotonSettings photonSettings;
+        photonSettings.trailCapacity = static_cast<size_t>(options.photonTrail);
+        photons = std::make_unique<PhotonSystem>(static_cast<size_t>(options.photons), blackHole, photonSettings);
+        std::cout << "GPU photons: " << photons->getPhotonCount() << ", " << options.photonTrail
+                  << " trail points each (" << photons->memoryBytes() / (1024 * 1024) << " MB)\n";
+
+        // --photon-check: run the same photons through rk4Step on the CPU and compare (no window needed to look at)
+        if (options.photonCheck)
+        {
+            if (!shadersOk)
+            {
+                return -1;
+            }
+            FrameParams checkParams{};
+            checkParams.blackHolePos = blackHole.position;
+            checkParams.Rs = static_cast<float>(blackHole.schwarzschildRadius);
+            frameParamsBuffer.update(checkParams);
+
+            const int checkSteps = 240;
+            PhotonCheck check = photons->checkAgainstCpu(*photonComputeShader, blackHole, photonStep, checkSteps);
+            double agreeing = 100.0 * static_cast<double>(check.agreeing) / static_cast<double>(std::max<size_t>(check.checked, 1));
+            std::cout << "Photon check: " << check.agreeing << " of " << check.checked << " photons (" << agreeing
+                      << "%) match the CPU after " << checkSteps << " steps, largest difference in r "
+                      << check.maxDifference << "\n";
+
+            photons.reset();  // deletes its buffers while the context is still alive
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return agreeing >= 99.9 ? 0 : 1;
+        }
+    }
+
+    // === CAUSTIC MAP (--caustics N) ===
+    // a beam of rays binned into a density grid by caustics.comp, a batch per frame until all rays are in
+    std::unique_ptr<CausticRenderer> caustics;
+    double causticStart = 0.0;
+    if (options.causticRays > 0)
+    {
+        caustics = std::make_unique<CausticRenderer>(static_cast<size_t>(options.causticRays), makeCausticSettings(options));
+        std::cout << "Caustic map: " << caustics->getRayCount() << " rays into " << options.width << "x"
+                  << options.height << " cells (" << caustics->memoryBytes() / 1024 << " KB)\n";
+
+        // --caustic-check: build the same map with CausticMap on the CPU and compare (no window needed to look at)
+        if (options.causticCheck)
+        {
+            if (!shadersOk)
+            {
+                return -1;
+            }
+            FrameParams checkParams{};
+            checkParams.blackHolePos = blackHole.position;
+            checkParams.Rs = static_cast<float>(blackHole.schwarzschildRadius);
+            frameParamsBuffer.update(checkParams);
+
+            ThreadPool checkPool(options.threads);
+            CausticCheck check = caustics->checkAgainstCpu(*causticComputeShader, blackHole, checkPool);
+            double totalDifference = 100.0 * std::abs(static_cast<double>(check.gpuTotal) - static_cast<double>(check.cpuTotal))
+                / static_cast<double>(std::max<uint64_t>(check.cpuTotal, 1));
+            double agreeing = 100.0 * static_cast<double>(check.cellsAgreeing) / static_cast<double>(std::max<size_t>(check.cellsChecked, 1));
+            std::cout << "Caustic check: " << check.gpuTotal << " GPU / " << check.cpuTotal << " CPU counts ("
+                      << totalDifference << "% apart), " << check.cellsAgreeing << " of " << check.cellsChecked
+                      << " cells (" << agreeing << "%) within 10%, largest cell difference " << check.maxRelativeError * 100.0f << "%\n";
+
+            caustics.reset();  // deletes its buffers while the context is still alive
+            photons.reset();
+            trailRenderer.reset();
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return totalDifference <= 0.5 && agreeing >= 99.0 ? 0 : 1;
+        }
+    }
+
+    // Per-pass timings (--profile FILE). The rolling averages go in the window title,
+    // every frame and pass is written to the file on exit.
+    std::unique_ptr<Profiler> profiler;
+    double lastTitleUpdate = 0.0;
+    const double titleUpdateInterval = 0.5;  // seconds
+    if (!options.profilePath.empty())
+    {
+        profiler = std::make_unique<Profiler>();
+    }
+
+    // --render-rate: frames are spaced at least this far apart (0 = as fast as the swap allows)
+    double minFrameSeconds = options.renderRate > 0.0f ? 1.0 / options.renderRate : 0.0;
+    double lastFrameTime = glfwGetTime();
 
     // Main render loop
     while (!glfwWindowShouldClose(window))
     {
-        // Process keyboard input (W/S to zoom)
-        float deltaTime = 0.016f;  // ~60 FPS
+        if (profiler) profiler->beginFrame();
+
+        // Process keyboard input (W/S to zoom), by the real time the last frame took
+        double frameTime = glfwGetTime();
+        float deltaTime = static_cast<float>(std::min(frameTime - lastFrameTime, 0.1));
+        lastFrameTime = frameTime;
         camera.processKeyboard(window, deltaTime);
 
         // Clear screen to PURE BLACK background (like reference)
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Pure black
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		//bind compute shader
-        computeShader.Use();
-
-        // Set uniforms for compute shader
-        computeShader.SetVec2("u_blackHolePos", glm::vec2(x, y));
-        computeShader.SetFloat("u_mass", static_cast<float>(mass));
-        computeShader.SetFloat("u_Rs", static_cast<float>(blackHole.schwarzschildRadius));
-        computeShader.SetVec2("u_screenSize", glm::vec2(screenWidth, screenHeight));
-
-        glm::vec3 camPos = camera.getPosition();
-        computeShader.SetVec3("u_cameraPos", camPos);
-        computeShader.SetFloat("u_cameraFOV", camera.fov);
-
-        glBindImageTexture(0, graphics.getTexture(),0,GL_FALSE,0, GL_WRITE_ONLY, GL_RGBA8);
+        // Only re-trace when something that changes the picture changed. When the view stays still
+        // keep adding jittered samples until the image has converged, then stop tracing altogether.
+        bool viewChanged = camera.consumeChanges();
+        if (g_framebufferResized)
+        {
+            // new trace textures at the window's size, the samples summed so far are gone with the old ones
+            g_framebufferResized = false;
+            bool sizeChanged = g_framebufferWidth > 0 && g_framebufferHeight > 0
+                && (g_framebufferWidth != graphics.getWidth() || g_framebufferHeight != graphics.getHeight());
+            if (recorder && sizeChanged)
+            {
+                // the recording's frame size is fixed, everything read back from now on would be dropped
+                std::cout << "Window resized to " << g_framebufferWidth << "x" << g_framebufferHeight
+                          << ", stopping the recording (its frames are " << options.width << "x" << options.height << ")\n";
+                stopRecording();
+            }
+            if (graphics.resize(g_framebufferWidth, g_framebufferHeight))
+            {
+                screenWidth = static_cast<float>(graphics.getWidth());
+                screenHeight = static_cast<float>(graphics.getHeight());
+                projection = overlayProjection(sceneSize, glm::vec2(screenWidth, screenHeight));
+                viewChanged = true;
+            }
+        }
+        if (!(blackHole == tracedBlackHole))
+        {
+            tracedBlackHole = blackHole;
+            viewChanged = true;
+            if (lensCache)
+            {
+                lensCache->clear();  // traced for the old hole
+            }
+        }
+        if (viewChanged)
+        {
+            sampleIndex = 0;
+        }
+        bool traceThisFrame = sampleIndex < maxAccumulatedSamples;
+
+        // Everything the shaders need this frame goes into the FrameParams uniform buffer in one upload
+        // (the compute shader and the grid shaders both read it, see Shaders/FrameParams.glsl)
+        FrameParams frameParams{};
+        frameParams.cameraView = camera.getViewMatrix();
+        frameParams.cameraProjection = camera.getProjectionMatrix(screenWidth / screenHeight);
+        frameParams.cameraPos = camera.getPosition();
+        frameParams.cameraFOV = camera.fov;
+        frameParams.blackHolePos = blackHole.position;
+        frameParams.screenSize = glm::vec2(screenWidth, screenHeight);
+        frameParams.mass = static_cast<float>(blackHole.mass);
+        frameParams.Rs = static_cast<float>(blackHole.schwarzschildRadius);
+        frameParams.tolerance = options.tolerance;
+        frameParams.integrator = options.adaptive ? 1 : 0;
+        frameParams.renderMode = graphics.hasDeflectionTable() ? 1 : 0;
+        frameParams.sampleIndex = sampleIndex;
+        // first sample goes through the pixel corner like before, the rest are spread over the pixel
+        frameParams.jitter = sampleIndex == 0 ? glm::vec2(0.0f) : glm::vec2(halton(sampleIndex, 2), halton(sampleIndex, 3));
+        frameParamsBuffer.update(frameParams);
+
+        if (traceThisFrame)
+        {
+            ProfileZone geodesicZone(profiler.get(), "geodesic");
+
+            //bind compute shader
+            computeShader.Use();
+            if (graphics.hasDeflectionTable())
+            {
+                graphics.bindDeflectionTable(computeShader);
+            }
+
+            // Only the frames that print the step counters count them (the other frames skip the atomics)
+            bool reportStats = ++frameCounter % statsReportInterval == 0;
+            computeShader.SetInt("u_collectStats", reportStats ? 1 : 0);
+            if (reportStats)
+            {
+                const GLuint zeroStats[2] = { 0, 0 };
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, integratorStatsBuffer);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeroStats), zeroStats);
+            }
+
+            // output (unit 0) and accumulation (unit 1) images
+            graphics.bindForCompute();
+
+            // Camera moved: shade from the lens map of its bucket, only tracing one if it isn't cached.
+            // (the map holds for every azimuth as long as the camera looks at the hole from its target)
+            bool fromLensMap = false;
+            if (lensCache && viewChanged && camera.target == glm::vec3(blackHole.position.x, 0.0f, blackHole.position.y))
+            {
+                int mapWidth = graphics.getWidth();
+                int mapHeight = graphics.getHeight();
+                LensMapKey key = lensCache->keyFor(camera, mapWidth, mapHeight);
+                GLuint map = lensCache->find(key);
+                if (map == 0 && (map = lensCache->insert(key)) != 0)
+                {
+                    // traced from the middle of the bucket, so it's the same map whichever camera in it asked first
+                    FrameParams traceParams = frameParams;
+                    traceParams.cameraPos = lensCache->bucketCamera(key, camera).getPosition();
+                    frameParamsBuffer.update(traceParams);
+                    lensCache->trace(computeShader, map, mapWidth, mapHeight);
+                    frameParamsBuffer.update(frameParams);
+                }
+                if (map != 0)
+                {
+                    lensCache->shade(computeShader, map, mapWidth, mapHeight);
+                    fromLensMap = true;
+                }
+            }
+
+            if (fromLensMap)
+            {
+                // nothing else to do, the shade pass wrote the whole frame
+            }
+            else if (hierarchical)
+            {
+                // coarse pass, tile classification, then only the mixed tiles at full resolution
+                graphics.traceHierarchical(computeShader);
+            }
+            else
+            {
+                computeShader.SetInt("u_pass", 0);
+                int workGroupsX, workGroupsY;
+                graphics.getWorkGroups(workGroupsX, workGroupsY);
+                //this will dispatch the compute shader with enough work groups to cover the whole texture.
+                glDispatchCompute(workGroupsX, workGroupsY, 1);
+            }
+            //makes the writes visible and fences the target, the quad shows it once the GPU is done with it
+            graphics.endCompute();
+            // a lens map frame is only close to this exact view, once the camera stops sample 0 is traced again
+            if (!fromLensMap)
+            {
+                sampleIndex++;
+            }
+
+            // Every few seconds print how many integration steps a frame took
+            if (reportStats)
+            {
+                glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+                GLuint frameStats[2] = { 0, 0 };
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, integratorStatsBuffer);
+                glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(frameStats), frameStats);
+                std::cout << "Integrator: " << frameStats[0] << " steps, " << frameStats[1] << " rejected ("
+                          << static_cast<double>(frameStats[0]) / (screenWidth * screenHeight) << " steps/pixel)\n";
+                if (hierarchical)
+                {
+                    std::cout << "Refined " << graphics.readRefinedTileCount() << " of " << graphics.getTileCount()
+                              << " tiles\n";
+                }
+            }
+            if (sampleIndex == maxAccumulatedSamples)
+            {
+                std::cout << "View converged after " << sampleIndex << " samples, waiting for input\n";
+            }
+        }
 
-		int workGroupsX, workGroupsY;
-        graphics.getWorkGroups(workGroupsX, workGroupsY);
-		//this will dispatch the compute shader with enough work groups to cover the whole texture.
-        glDispatchCompute(workGroupsX, workGroupsY, 1);
-		//this will tell opengl to wait until the compute shader is done writing to the texture.
-		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        if (recorder)
+        {
+            ProfileZone readbackZone(profiler.get(), "readback");
+            graphics.collectReadbacks(recordFrameTo);
+            graphics.requestReadback(recordFrame++);
+        }
 
-        graphics.renderQuad(quadShader);
+        {
+            ProfileZone quadZone(profiler.get(), "quad");
+            graphics.renderQuad(quadShader);
+        }
 
         // === Render spacetime grid with warping ===
+        if (profiler) profiler->beginZone("grid");
         // Enable blending for transparency
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -334,27 +984,138 @@ int main()
         gridModel = glm::translate(gridModel, glm::vec3(x, 0.0f, y));  // Center grid at black hole on ground plane
         gridModel = glm::rotate(gridModel, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));  // Rotate to stand upright
 
+        // Camera matrices, black hole position and Rs come from FrameParams
         gridShader.SetMat4("u_Model", gridModel);
-        gridShader.SetMat4("u_View", camera.getViewMatrix());
-        gridShader.SetMat4("u_Projection", camera.getProjectionMatrix(screenWidth / screenHeight));
 
         // Set grid-specific uniforms
-        gridShader.SetVec2("u_blackHolePos", glm::vec2(x, y));
-        gridShader.SetFloat("u_Rs", static_cast<float>(blackHole.schwarzschildRadius));
-        gridShader.SetFloat("u_warpStrength", 400.0f);  // MUCH stronger warp for deep funnel!
+        gridShader.SetFloat("u_warpStrength", gridWarpStrength);
 
-        // Draw grid as lines
-        gridMesh.draw_Lines();
+        // Draw grid as lines (the level of detail follows the camera distance)
+        grid.draw(camera.radius);
 
         glDisable(GL_BLEND);
         glDisable(GL_DEPTH_TEST);
+        if (profiler) profiler->endZone();
 
-        // Swap buffers and poll events
+        // === Pick up the light rays from the simulation thread and draw their trails (one draw call for the whole fan) ===
+        if (trailRenderer)
+        {
+            ProfileZone trailsZone(profiler.get(), "trails");
+            if (raySimulation->sample(rayPositions, rayActive))
+            {
+                for (size_t i = 0; i < rayPositions.size(); ++i)
+                {
+                    if (rayActive[i])
+                    {
+                        trails.push(i, rayPositions[i]);
+                    }
+                }
+            }
+            trailRenderer->draw(trails, mainShader, projection, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));  // Yellow trails
+        }
+
+        // === Step the GPU photons and draw their trails (no CPU work or transfers per photon) ===
+        if (photons)
+        {
+            ProfileZone photonsZone(profiler.get(), "photons");
+            photonTime += deltaTime;
+            int steps = std::min(static_cast<int>(photonTime / photonStep), maxPhotonStepsPerFrame);
+            photonTime = steps == maxPhotonStepsPerFrame ? 0.0f : photonTime - steps * photonStep;
+            photons->step(*photonComputeShader, photonStep, steps);
+            photons->draw(*photonShader, projection, glm::vec4(1.0f, 0.6f, 0.2f, 0.5f));
+        }
+
+        // === Add the next batch of rays to the caustic map and draw it ===
+        if (caustics)
+        {
+            ProfileZone causticsZone(profiler.get(), "caustics");
+            if (!caustics->isComplete())
+            {
+                if (caustics->getRaysDone() == 0)
+                {
+                    causticStart = glfwGetTime();
+                }
+                caustics->accumulate(*causticComputeShader);
+                if (caustics->isComplete())
+                {
+                    // once, so the time is the GPU's and not just how long the dispatches took to queue
+                    glFinish();
+                    std::cout << "Caustic map built in " << (glfwGetTime() - causticStart) * 1000.0 << " ms\n";
+                }
+            }
+            caustics->draw(*causticShader, projection, glm::vec2(screenWidth, screenHeight), 0.85f);
+        }
+
+        if (profiler)
+        {
+            profiler->endFrame();
+            double now = glfwGetTime();
+            if (now - lastTitleUpdate > titleUpdateInterval)
+            {
+                lastTitleUpdate = now;
+                glfwSetWindowTitle(window, ("BLACK_HOLE_SIM | " + profiler->summaryText()).c_str());
+            }
+        }
+
+        // Swap buffers and handle events. Once the image has converged (and no trails are moving)
+        // there is nothing left to draw, so sleep until the user does something instead of spinning.
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        bool idle = sampleIndex >= maxAccumulatedSamples && !trailRenderer && !photons && !recorder
+            && (!caustics || caustics->isComplete())
+            && glfwGetKey(window, GLFW_KEY_W) != GLFW_PRESS && glfwGetKey(window, GLFW_KEY_S) != GLFW_PRESS;
+        if (idle)
+        {
+            glfwWaitEvents();
+        }
+        else
+        {
+            glfwPollEvents();
+        }
+
+        if (minFrameSeconds > 0.0)
+        {
+            double frameEnd = frameTime + minFrameSeconds;
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::max(0.0, frameEnd - glfwGetTime())));
+        }
+    }
+
+    if (raySimulation)
+    {
+        raySimulation->stop();
+        std::cout << "Simulation steps: " << raySimulation->getTicks() << " ("
+                  << raySimulation->getDroppedTicks() << " skipped because it fell behind)\n";
+    }
+
+    if (profiler)
+    {
+        profiler->flush();
+        std::cout << "Profile: " << profiler->summaryText() << "\n";
+        std::cout << "Frames dropped (GPU results not ready in time): " << profiler->getDroppedFrames() << "\n";
+        if (profiler->writeFile(options.profilePath))
+        {
+            std::cout << "Wrote profile " << options.profilePath << "\n";
+        }
+        profiler.reset();  // deletes its queries while the context is still alive
+    }
+
+    if (lensCache)
+    {
+        std::cout << "Lens map cache: " << lensCache->getHits() << " hits, " << lensCache->getMisses() << " misses, "
+                  << lensCache->getEvictions() << " evicted, " << lensCache->getMapCount() << " maps ("
+                  << lensCache->memoryBytes() / (1024.0 * 1024.0) << " MB)\n";
+        lensCache.reset();  // deletes its textures while the context is still alive
+    }
+
+    if (recorder)
+    {
+        stopRecording();
     }
 
-    // Cleanup
+    // Cleanup (the GL objects go before the context does)
+    trailRenderer.reset();
+    photons.reset();
+    caustics.reset();
+    glDeleteBuffers(1, &integratorStatsBuffer);
     glfwDestroyWindow(window);
     glfwTerminate();
 